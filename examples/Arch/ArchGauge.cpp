@@ -15,25 +15,25 @@ ArchGauge::ArchGauge(QWidget *parent) :
 
     mArchGauge = new QcGaugeWidget;
 
+    // scale shared by all the items
+    QSharedPointer<QcScale> archScale(new QcScale);
+    archScale->setValueRange(-90,90);
+    archScale->setDegreeOffset(0);
+    archScale->setDegreeRange(-90,90);
+
     // drawing circular arc
     auto centerArc=mArchGauge->addArc(55);
-    centerArc->setValueRange(-90,90);
-    centerArc->setDegreeOffset(90);
-    centerArc->setDegreeRange(-90,90);
+    centerArc->setScale(archScale);
 
     // drawing ticks
     auto centerArcTicks = mArchGauge->addDegrees(65);
-    centerArcTicks->setValueRange(-90,90);
-    centerArcTicks->setDegreeOffset(0);
-    centerArcTicks->setDegreeRange(-90,90);
+    centerArcTicks->setScale(archScale);
     centerArcTicks->setStep(10);
     centerArcTicks->setSubDegree(true);
 
     // drawing step values
     auto itemValues = mArchGauge->addValues(75);
-    itemValues->setValueRange(-90,90);
-    itemValues->setDegreeOffset(0);
-    itemValues->setDegreeRange(-90,90);
+    itemValues->setScale(archScale);
     itemValues->setStep(30);
 
     mArchGauge->addLabel(10)->setText("Pitch");
@@ -43,9 +43,7 @@ ArchGauge::ArchGauge(QWidget *parent) :
     mArchNeedle = mArchGauge->addNeedle(50);
     mArchNeedle->setLabel(lab);
     mArchNeedle->setColor(Qt::gray);
-    mArchNeedle->setValueRange(-90,90);
-    mArchNeedle->setDegreeOffset(0);
-    mArchNeedle->setDegreeRange(-90,90);
+    mArchNeedle->setScale(archScale);
     mArchNeedle->setCurrentValue(0);
 
     ui->verticalLayout->addWidget(mArchGauge);
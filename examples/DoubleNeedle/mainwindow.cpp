@@ -22,17 +22,19 @@ MainWindow::MainWindow(QWidget *parent) :
      bkg2->addColor(1.0,Qt::white);
 */
 
+     // scale shared by the arc, the ticks and the first needle
+     QSharedPointer<QcScale> circleScale(new QcScale);
+     circleScale->setValueRange(0,360);
+     circleScale->setDegreeOffset(90);
+     circleScale->setDegreeRange(0,360);
+
      // drawing circular arc
      auto centerArc=mSpeedGauge->addArc(55);
-     centerArc->setValueRange(0,360);
-     centerArc->setDegreeOffset(90);
-     centerArc->setDegreeRange(0,360);
+     centerArc->setScale(circleScale);
 
      // drawing ticks
      auto centerArcTicks = mSpeedGauge->addDegrees(65);
-     centerArcTicks->setValueRange(0,360);
-     centerArcTicks->setDegreeOffset(90);
-     centerArcTicks->setDegreeRange(0,360);
+     centerArcTicks->setScale(circleScale);
      centerArcTicks->setStep(10);
      centerArcTicks->setSubDegree(false);
 
@@ -46,9 +48,7 @@ MainWindow::MainWindow(QWidget *parent) :
      // add first needle
      mAWANeedle = mSpeedGauge->addNeedle(60);
      mAWANeedle->setColor(Qt::red);
-     mAWANeedle->setValueRange(0,360);
-     mAWANeedle->setDegreeOffset(90);
-     mAWANeedle->setDegreeRange(0,360);
+     mAWANeedle->setScale(circleScale);
      mAWANeedle->setCurrentValue(60);
 
      // add second needle
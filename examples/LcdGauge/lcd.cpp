@@ -13,13 +13,20 @@ lcd::lcd(QWidget *parent) :
     ui->setupUi(this);
 
     // get the palette
-    auto palette = ui->lcdNumber->palette();
+    auto palette = ui->label->palette();
     // foreground color
     palette.setColor(palette.WindowText, Qt::darkRed);
-    // set the palette back
-    ui->lcdNumber->setPalette(palette);
-    // set style
-    ui->lcdNumber->setSegmentStyle(QLCDNumber::Flat);
+
+    // the readout is drawn by the gauge itself, no QLCDNumber widget
+    mGauge = new QcGaugeWidget;
+    mGauge->setMinimumSize(250,80);
+    mReadout = mGauge->addDigitalReadout(0);
+    mReadout->setDigitCount(6);
+    mReadout->setDigitHeight(50);
+    mReadout->setColor(Qt::darkRed);
+    // dim the unlit segments
+    mReadout->setOffColor(QColor(139,0,0,25));
+    ui->horizontalLayout->insertWidget(0,mGauge);
 
     ui->label->setText("K");
     ui->label->setPalette(palette);
@@ -32,5 +39,5 @@ lcd::~lcd() {
 
 void lcd::on_horizontalSlider_valueChanged(int value)
 {
-    ui->lcdNumber->display(value);
+    mReadout->setValue(value);
 }
\ No newline at end of file
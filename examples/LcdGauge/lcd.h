@@ -6,6 +6,7 @@
 #define QCGAUGEWIDGET_LCD_H
 
 #include <QWidget>
+#include "qcgaugewidget.h"
 
 
 QT_BEGIN_NAMESPACE
@@ -23,6 +24,9 @@ public:
 private:
     Ui::lcd *ui;
 
+    QcGaugeWidget *mGauge;
+    QcDigitalReadoutItem *mReadout;
+
 private slots:
     void on_horizontalSlider_valueChanged(int value);
 };
@@ -0,0 +1,189 @@
+//
+// PaintAllocations-example [frames]
+//
+// Counts the heap allocations of the steady-state paint path: values
+// change, then the shown gauge paints again with its configuration
+// unchanged, through paintEvent() into an image.
+//
+// The setters run inside a QcValueBatch, so they post no events; the label
+// and readout formatting they defer runs in the paint. Qt allocates in
+// QWidget::render() and when a painter is made, so a plain widget painting
+// the same way is rendered every frame and its count is subtracted. The
+// batch commit, which posts the repaint, isn't counted, and neither is the
+// warmup: a tenth of the frames, at least one cycle of the values, which
+// fills the caches. Exits with 1 if a counted frame allocated, so it can
+// run in a build script:
+//
+//   QT_QPA_PLATFORM=offscreen ./PaintAllocations-example 1000
+//
+
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <atomic>
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QStyleOption>
+#include "qcgaugewidget.h"
+
+static std::atomic<bool> counting(false);
+static std::atomic<long> allocations(0);
+
+static inline void countAllocation()
+{
+    if(counting.load(std::memory_order_relaxed))
+        allocations.fetch_add(1,std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+// Qt containers, images and strings allocate with malloc(), not operator
+// new, so with glibc the C allocator is interposed; operator new ends up
+// there as well
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count,size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(p,size);
+}
+}
+#else
+void *operator new(size_t size)
+{
+    countAllocation();
+    if(void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+#endif
+
+// what QcGaugeWidget::paintEvent() does before and around its own work
+class PlainWidget : public QWidget
+{
+protected:
+    void paintEvent(QPaintEvent *)
+    {
+        QStyleOption opt;
+        opt.init(this);
+        QPainter painter(this);
+        style()->drawPrimitive(QStyle::PE_Widget, &opt, &painter, this);
+        painter.setRenderHint(QPainter::Antialiasing);
+    }
+};
+
+static long countRender(QWidget *widget, QImage *image)
+{
+    long before = allocations.load();
+    counting.store(true);
+    widget->render(image);
+    counting.store(false);
+    return allocations.load()-before;
+}
+
+int main(int argc, char *argv[])
+{
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM","offscreen");
+    QApplication a(argc, argv);
+    // the values repeat after this many frames, every sprite is made by then
+    const int cycle = 50;
+    int frames = argc>1 ? qMax(atoi(argv[1]),2*cycle) : 1000;
+
+    // one of each item the library draws; shown, as a hidden gauge keeps
+    // its changes back until it paints
+    QcGaugeWidget gauge;
+    gauge.resize(400,400);
+    gauge.addBackground(99);
+    gauge.addColorBand(50);
+    gauge.addArc(55);
+    gauge.addDegrees(90)->setStep(5);
+    gauge.addValues(75)->setStep(10);
+    QcLabelItem *unit = gauge.addLabel(70);
+    unit->setText("km/h");
+    QcLabelItem *label = gauge.addLabel(40);
+    QcNeedleItem *needle = gauge.addNeedle(80);
+    needle->setLabel(label);
+    QcNeedleItem *spriteNeedle = gauge.addNeedle(60);
+    spriteNeedle->setSpriteCount(360);
+    QcDigitalReadoutItem *readout = gauge.addDigitalReadout(0);
+    readout->setDigitCount(5);
+    gauge.addGlass(88);
+
+    QcLiteLayer *lite = gauge.addLiteLayer();
+    QSharedPointer<QcScale> scale(new QcScale);
+    scale->setValueRange(0,100);
+    int s = lite->addScale(scale);
+    lite->addDegrees(30,s,10);
+    lite->addValues(25,s,20);
+    int liteNeedle = lite->addNeedle(30,s);
+    lite->setLabel(liteNeedle,lite->addLabel(20,QString()));
+
+    PlainWidget plain;
+    plain.resize(gauge.size());
+    gauge.show();
+    plain.show();
+    a.processEvents();
+
+    QImage image(gauge.size(),QImage::Format_ARGB32_Premultiplied);
+
+    int warmup = qMax(frames/10,cycle);
+    long worst = 0;
+    int dirtyFrames = 0;
+    for(int frame=0;frame<frames;frame++){
+        float value = 10+frame%cycle;
+        long before = allocations.load();
+        counting.store(true);
+        QcValueBatch::begin();
+        needle->setCurrentValue(value);
+        spriteNeedle->setCurrentValue(value);
+        readout->setValue(value*10.5,1);
+        lite->setCurrentValue(liteNeedle,value);
+        counting.store(false);
+        long made = allocations.load()-before;
+        QcValueBatch::commit();
+
+        long allowance = countRender(&plain,&image);
+        made += countRender(&gauge,&image)-allowance;
+        if(frame>=warmup && made>0){
+            dirtyFrames++;
+            worst = qMax(worst,made);
+        }
+        // the repaints the value changes queued
+        a.processEvents();
+    }
+
+    printf("%d frames counted, %d allocated, at most %ld allocations in one frame beyond Qt's\n",
+           frames-warmup,dirtyFrames,worst);
+    return dirtyFrames>0 ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+//
+// ValueBus-example [writers [channels [rate]]]
+//
+// Starts the UI and the given number of writer processes, each writing
+// <channels> channels at <rate> Hz. The status line shows the write and
+// update throughput and the age of the samples when a frame reads them.
+//
+
+#include "mainwindow.h"
+#include <QApplication>
+#include <QThread>
+#include <QtMath>
+
+static int runWriter(int index, int channels, int rate)
+{
+    QcValueBus bus(VALUEBUS_KEY);
+    for(int tries=0;!bus.attach();tries++){
+        if(tries>500)
+            return 1;
+        QThread::msleep(10);
+    }
+
+    QVector<int> channelSlots;
+    for(int i=0;i<channels;i++){
+        QByteArray name = QString("w%1.c%2").arg(index).arg(i).toLatin1();
+        channelSlots.append(bus.addSlot(name.constData()));
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    unsigned long period = 1000000/qMax(rate,1);
+    for(;;){
+        double t = clock.elapsed()/1000.0;
+        for(int i=0;i<channels;i++)
+            if(channelSlots[i]>=0)
+                bus.write(channelSlots[i],50+45*qSin(t+index+i*0.3));
+        QThread::usleep(period);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc>=5 && qstrcmp(argv[1],"--writer")==0){
+        QCoreApplication a(argc, argv);
+        return runWriter(atoi(argv[2]),atoi(argv[3]),atoi(argv[4]));
+    }
+
+    QApplication a(argc, argv);
+    int writers = argc>1 ? atoi(argv[1]) : 3;
+    int channels = argc>2 ? atoi(argv[2]) : 50;
+    int rate = argc>3 ? atoi(argv[3]) : 100;
+    MainWindow w(qMax(writers,1),qMax(channels,2),rate);
+    w.show();
+
+    return a.exec();
+}
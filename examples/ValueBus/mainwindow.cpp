@@ -0,0 +1,122 @@
+#include "mainwindow.h"
+#include <QCoreApplication>
+#include <QGridLayout>
+#include <QLabel>
+#include <QProcess>
+#include <QTimer>
+
+MainWindow::MainWindow(int writers, int channels, int rate, QWidget *parent) :
+    QMainWindow(parent)
+{
+    mBus = new QcValueBus(VALUEBUS_KEY,this);
+    if(!mBus->create(writers*channels) && !mBus->attach())
+        qWarning("value bus: %s",qPrintable(mBus->errorString()));
+
+    QWidget *central = new QWidget(this);
+    QGridLayout *layout = new QGridLayout(central);
+    setCentralWidget(central);
+
+    // one gauge per writer: a needle on its first channel, a readout on the second
+    for(int i=0;i<writers;i++){
+        QcGaugeWidget *gauge = new QcGaugeWidget;
+        gauge->setLatencyTracking(true);
+        mGauges.append(gauge);
+        gauge->addBackground(99);
+        gauge->addDegrees(90)->setStep(10);
+        gauge->addValues(75)->setStep(20);
+        QcDigitalReadoutItem *readout = gauge->addDigitalReadout(0);
+        readout->setDigitCount(5);
+        readout->setDigitHeight(15);
+        QcLabelItem *label = gauge->addLabel(40);
+        QcNeedleItem *needle = gauge->addNeedle(80);
+        needle->setLabel(label);
+
+        QByteArray name = QString("w%1.c0").arg(i).toLatin1();
+        mBus->bind(name.constData(),needle);
+        name = QString("w%1.c1").arg(i).toLatin1();
+        mBus->bind(name.constData(),readout);
+        layout->addWidget(gauge,i/3,i%3);
+    }
+    mStatus = new QLabel;
+    layout->addWidget(mStatus,(writers+2)/3,0,1,3);
+
+    for(int i=0;i<writers;i++){
+        QProcess *writer = new QProcess(this);
+        writer->setProgram(QCoreApplication::applicationFilePath());
+        writer->setArguments(QStringList() << "--writer" << QString::number(i)
+                             << QString::number(channels) << QString::number(rate));
+        writer->start();
+        mWriters.append(writer);
+    }
+
+    mWrites = mApplied = mAgeSum = mAgeMax = mAgeCount = 0;
+    mFrames = 0;
+    mWindow.start();
+
+    // the window polls the bus with its statistics on a free-running 16 ms
+    // timer, about once per display frame; the bus's own poll timer stays
+    // off. It isn't tied to the gauges' paints, so a value can wait up to
+    // one interval before its repaint is requested
+    QTimer *timer = new QTimer(this);
+    connect(timer,&QTimer::timeout,this,&MainWindow::frame);
+    timer->start(16);
+}
+
+MainWindow::~MainWindow()
+{
+    foreach (QProcess *writer, mWriters) {
+        writer->kill();
+        writer->waitForFinished(1000);
+    }
+}
+
+void MainWindow::frame()
+{
+    mApplied += mBus->poll();
+    mFrames++;
+
+    // every completed write moves the slot sequence on by two
+    qint64 now = QcValueBus::timestamp();
+    int count = mBus->slotCount();
+    mVersions.resize(count);
+    for(int i=0;i<count;i++){
+        quint32 version = mBus->version(i);
+        if(version==mVersions[i])
+            continue;
+        mWrites += (version-mVersions[i])/2;
+        mVersions[i] = version;
+
+        float value;
+        qint64 stamp;
+        if(mBus->read(i,&value,&stamp)){
+            qint64 age = now-stamp;
+            mAgeSum += age;
+            mAgeMax = qMax(mAgeMax,age);
+            mAgeCount++;
+        }
+    }
+
+    if(mWindow.elapsed()<1000)
+        return;
+    double seconds = mWindow.restart()/1000.0;
+    // sample stamp to the end of the paint showing it, over all gauges
+    QcLatencyHistogram latency;
+    foreach (QcGaugeWidget *gauge, mGauges) {
+        latency.merge(gauge->latency());
+        gauge->resetLatency();
+    }
+    mStatus->setText(QString("%1 channels, %2 writes/s, %3 gauge updates/s, %4 frames/s, "
+                             "age at frame time avg %5 us max %6 us, "
+                             "sample to pixel p50 %7 us p99 %8 us max %9 us")
+                     .arg(count)
+                     .arg(qRound64(mWrites/seconds))
+                     .arg(qRound64(mApplied/seconds))
+                     .arg(qRound64(mFrames/seconds))
+                     .arg(mAgeCount ? mAgeSum/mAgeCount/1000 : 0)
+                     .arg(mAgeMax/1000)
+                     .arg(latency.percentile(0.5))
+                     .arg(latency.percentile(0.99))
+                     .arg(latency.max()));
+    mWrites = mApplied = mAgeSum = mAgeMax = mAgeCount = 0;
+    mFrames = 0;
+}
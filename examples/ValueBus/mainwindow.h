@@ -0,0 +1,46 @@
+//
+// Benchmark harness for QcValueBus: a UI process reading the bus at frame
+// time, and writer processes simulating the acquisition side.
+//
+
+#ifndef VALUEBUS_MAINWINDOW_H
+#define VALUEBUS_MAINWINDOW_H
+
+#include <QMainWindow>
+#include <QElapsedTimer>
+#include "qcgaugewidget.h"
+
+class QLabel;
+class QProcess;
+
+#define VALUEBUS_KEY "QcValueBus-example"
+
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    MainWindow(int writers, int channels, int rate, QWidget *parent = 0);
+    ~MainWindow();
+
+private slots:
+    void frame();
+
+private:
+    QcValueBus *mBus;
+    QList<QProcess*> mWriters;
+    QList<QcGaugeWidget*> mGauges;
+    QLabel *mStatus;
+
+    // counted over one second of frames
+    QVector<quint32> mVersions;
+    QElapsedTimer mWindow;
+    qint64 mWrites;
+    qint64 mApplied;
+    qint64 mAgeSum;
+    qint64 mAgeMax;
+    qint64 mAgeCount;
+    int mFrames;
+};
+
+#endif // VALUEBUS_MAINWINDOW_H
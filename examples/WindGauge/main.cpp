@@ -33,6 +33,8 @@ int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
     MainWindow w;
+    if(argc>1)
+        w.replay(argv[1]);
     w.show();
 
     return a.exec();
@@ -28,6 +28,7 @@
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include <QTimer>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -52,15 +53,17 @@ MainWindow::MainWindow(QWidget *parent) :
     bkg2->addColor(1.0,Qt::black);
     */
 
+    // scale shared by the arc, the ticks and the needle
+    QSharedPointer<QcScale> windScale(new QcScale);
+    windScale->setValueRange(-180,180);
+    windScale->setDegreeOffset(90);
+    windScale->setDegreeRange(-180,180);
+
     auto itemArc=mWindGauge->addArc(55);
-    itemArc->setValueRange(-180,180);
-    itemArc->setDegreeOffset(90);
-    itemArc->setDegreeRange(-180,180);
+    itemArc->setScale(windScale);
 
     auto itemDegrees = mWindGauge->addDegrees(65);
-    itemDegrees->setValueRange(-180,180);
-    itemDegrees->setDegreeOffset(90);
-    itemDegrees->setDegreeRange(-180,180);
+    itemDegrees->setScale(windScale);
     itemDegrees->setStep(10);
     itemDegrees->setSubDegree(true);
 
@@ -99,10 +102,7 @@ MainWindow::MainWindow(QWidget *parent) :
     mWindNeedle = mWindGauge->addNeedle(60);
     mWindNeedle->setLabel(lab);
     mWindNeedle->setColor(Qt::blue);
-
-    mWindNeedle->setValueRange(-180,180);
-    mWindNeedle->setDegreeOffset(90);
-    mWindNeedle->setDegreeRange(-180,180);
+    mWindNeedle->setScale(windScale);
 
     /*
     mWindGauge->addGlass(88);
@@ -110,6 +110,8 @@ MainWindow::MainWindow(QWidget *parent) :
 
     ui->horizontalLayout->addWidget(mWindGauge);
 
+    mSignalK = new QcSignalKReader(this);
+    mSignalK->bind("environment.wind.angleApparent",mWindNeedle,0,180/M_PI);
 }
 
 MainWindow::~MainWindow()
@@ -123,3 +125,25 @@ void MainWindow::on_horizontalSlider_valueChanged(int value)
 {
     mWindNeedle->setCurrentValue(value);
 }
+
+void MainWindow::replay(const QString &fileName)
+{
+    // a recorded Signal K delta stream, one message per line, in place of a server
+    mReplay.setFileName(fileName);
+    if(!mReplay.open(QIODevice::ReadOnly))
+        return;
+    QTimer *timer = new QTimer(this);
+    connect(timer,&QTimer::timeout,this,&MainWindow::replayNext);
+    timer->start(100);
+}
+
+void MainWindow::replayNext()
+{
+    char line[4096];
+    qint64 n = mReplay.readLine(line,sizeof(line));
+    if(n<=0){
+        mReplay.seek(0);
+        return;
+    }
+    mSignalK->feed(line,int(n));
+}
@@ -30,6 +30,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QFile>
 #include "qcgaugewidget.h"
 namespace Ui {
 class MainWindow;
@@ -43,14 +44,20 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+    void replay(const QString &fileName);
+
 private slots:
     void on_horizontalSlider_valueChanged(int value);
+    void replayNext();
 
 private:
     Ui::MainWindow *ui;
 
     QcGaugeWidget *mWindGauge;
     QcNeedleItem *mWindNeedle;
+
+    QcSignalKReader *mSignalK;
+    QFile mReplay;
 };
 
 #endif // MAINWINDOW_H
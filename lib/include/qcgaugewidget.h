@@ -32,9 +32,18 @@
 #include <QWidget>
 #include <QPainter>
 #include <QPainterPath>
+#include <QStaticText>
+#include <QImage>
 #include <QObject>
+#include <QHash>
 #include <QRectF>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QtMath>
+#include <atomic>
+#include <functional>
 
 
 
@@ -48,6 +57,7 @@
 
 class QcGaugeWidget;
 class QcItem;
+class QcScale;
 class QcBackgroundItem;
 class QcDegreesItem;
 class QcValuesItem;
@@ -57,6 +67,240 @@ class QcNeedleItem;
 class QcLabelItem;
 class QcGlassItem;
 class QcAttitudeMeter;
+class QcDigitalReadoutItem;
+class QcLiteLayer;
+class QcLiteItemFacade;
+class QcItemSnapshot;
+class QcGlyphAtlas;
+class QcValueBatch;
+class QcRenderJob;
+struct QcRenderLayer;
+struct QcCacheCounters;
+class QThreadPool;
+class QTimer;
+class QSharedMemory;
+class QIODevice;
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Trace events of the library (value ingestion, update scheduling, cache
+// rebuilds, item draws and paint events) kept in a ring buffer of the last
+// Capacity events, and written out as Chrome trace-event JSON for
+// chrome://tracing or Perfetto. Events are only recorded when the library
+// is built with QCGAUGE_TRACE; without it the QC_TRACE macros are empty.
+class QCGAUGE_DECL QcTrace
+{
+public:
+    enum {Capacity=1<<16};
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    static void clear();
+    static bool write(QIODevice *device);
+    static bool write(const QString &fileName);
+
+    // names and categories must be string literals, only the pointers are kept
+    static void complete(const char *name, const char *category, qint64 begin);
+    static void instant(const char *name, const char *category);
+    static qint64 now();
+};
+
+class QcTraceScope
+{
+public:
+    inline QcTraceScope(const char *name, const char *category) :
+        mName(name), mCategory(category), mBegin(QcTrace::now()) {}
+    inline ~QcTraceScope()
+    {
+        QcTrace::complete(mName,mCategory,mBegin);
+    }
+
+private:
+    const char *mName;
+    const char *mCategory;
+    qint64 mBegin;
+};
+
+#define QC_TRACE_CONCAT2(a,b) a##b
+#define QC_TRACE_CONCAT(a,b) QC_TRACE_CONCAT2(a,b)
+#ifdef QCGAUGE_TRACE
+#define QC_TRACE_SCOPE(name,category) QcTraceScope QC_TRACE_CONCAT(qcTraceScope,__LINE__)(name,category)
+#define QC_TRACE_INSTANT(name,category) QcTrace::instant(name,category)
+#else
+#define QC_TRACE_SCOPE(name,category)
+#define QC_TRACE_INSTANT(name,category)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Distribution of sample-to-pixel latencies in power of two buckets:
+// bucket i counts latencies below bucketLimit(i) = 2^i microseconds that
+// are not in a lower bucket. Results are in microseconds.
+class QCGAUGE_DECL QcLatencyHistogram
+{
+public:
+    enum {Buckets=32};
+
+    QcLatencyHistogram();
+    void add(qint64 nsecs);
+    void merge(const QcLatencyHistogram &other);
+    void clear();
+
+    quint64 count() const;
+    double mean() const;
+    qint64 max() const;
+    qint64 percentile(double p) const;
+    quint64 bucket(int i) const;
+    static qint64 bucketLimit(int i);
+
+private:
+    quint64 mBuckets[Buckets];
+    quint64 mCount;
+    qint64 mSum;
+    qint64 mMax;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// What the paints of a gauge, or of all gauges, did since construction or
+// the last reset. A cache hit reuses an image or outline as it is, a miss
+// creates one that wasn't there, a rebuild replaces one made stale by a
+// size, style or value change. Times are in milliseconds.
+struct QCGAUGE_DECL QcRenderStatistics
+{
+    enum Cache{FaceCache,TickCache,SpriteCache,GlyphCache,ReadoutCache,BandCache,CacheCount};
+
+    QcRenderStatistics();
+
+    quint64 framesPainted;
+    quint64 updatesRequested;
+    quint64 updatesCoalesced;  // requested while a repaint was pending already
+    quint64 valuesDropped;     // set to the value already shown
+    quint64 cacheHits[CacheCount];
+    quint64 cacheMisses[CacheCount];
+    quint64 cacheRebuilds[CacheCount];
+    qint64 cacheBytes;         // held now, not since the reset
+    float lastPaintTime;
+    float averagePaintTime;
+    float p99PaintTime;        // upper limit of its power of two bucket
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// One evictable cache: a gauge's faces, a needle's sprites, a glyph atlas,
+// a readout's cells or a band's outlines. Subclasses report their size
+// with setCacheBytes(), call touch() when drawn and drop their contents in
+// evict(), under their own lock; the next draw rebuilds them.
+class QCGAUGE_DECL QcCacheEntry
+{
+public:
+    explicit QcCacheEntry(QcRenderStatistics::Cache kind);
+    virtual ~QcCacheEntry();
+    qint64 cacheBytes() const;
+    // lock free, both may be called on the steady paint path
+    void touch();
+    void setCacheBytes(qint64 bytes);
+
+protected:
+    virtual void evict() = 0;
+
+private:
+    friend class QcCacheManager;
+    QcRenderStatistics::Cache mKind;
+    std::atomic<qint64> mBytes;
+    std::atomic<quint64> mLastUse;
+    std::atomic<QcCacheCounters*> mOwner;  // gauge that drew it last
+};
+
+// Keeps the caches of all gauges within one byte budget. Over budget the
+// least recently drawn caches are evicted, those of gauges that aren't
+// exposed before any other. Trimming happens on the GUI thread after a
+// paint, render threads only account what they build.
+class QCGAUGE_DECL QcCacheManager
+{
+public:
+    // 0, the default, leaves the caches unbounded
+    static void setBudget(qint64 bytes);
+    static qint64 budget();
+    static qint64 usage();
+    static qint64 usage(QcRenderStatistics::Cache kind);
+    static qint64 peakUsage();
+    static quint64 evictions();
+    static int trim();
+
+private:
+    friend class QcCacheEntry;
+    friend class QcGaugeWidget;
+    static void add(QcCacheEntry *entry);
+    static void remove(QcCacheEntry *entry);
+    static void resize(QcCacheEntry *entry, qint64 delta);
+    static void forget(QcCacheCounters *owner);
+    static void trimIfNeeded();
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Paces the repaints of the gauges attached to it by priority class. On
+// every tick the due gauges are served critical first, then normal, then
+// background, until the estimated paint time of the tick reaches the
+// budget; the others stay pending, so background gauges starve first.
+class QCGAUGE_DECL QcUpdateScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority{Critical,Normal,Background,PriorityCount};
+
+    struct Statistics
+    {
+        float targetRate;
+        float achievedRate;  // frames per second per active gauge
+        int gauges;
+        int deferred;        // due frames postponed by the budget
+    };
+
+    explicit QcUpdateScheduler(QObject *parent = 0);
+    ~QcUpdateScheduler();
+    static QcUpdateScheduler* instance();
+
+    void setTargetRate(Priority priority, float hz);
+    float targetRate(Priority priority);
+    void setTickBudget(float msecs);
+    float tickBudget();
+    Statistics statistics(Priority priority);
+
+private slots:
+    void tick();
+
+private:
+    friend class QcGaugeWidget;
+    void addGauge(QcGaugeWidget *gauge);
+    void removeGauge(QcGaugeWidget *gauge);
+    void request();
+    void updateInterval();
+    void closeWindow(qint64 now);
+
+    QVector<QcGaugeWidget*> mGauges[PriorityCount];
+    int mNext[PriorityCount];
+    float mRate[PriorityCount];
+    float mTickBudget;
+    QTimer *mTimer;
+    QElapsedTimer mClock;
+
+    // counted over the current statistics window
+    qint64 mWindowStart;
+    int mServed[PriorityCount];
+    int mDeferred[PriorityCount];
+    Statistics mStatistics[PriorityCount];
+};
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -65,6 +309,7 @@ class QCGAUGE_DECL QcGaugeWidget : public QWidget
     Q_OBJECT
 public:
     explicit QcGaugeWidget(QWidget *parent = 0);    
+    ~QcGaugeWidget();
 
     QcBackgroundItem* addBackground(float position);
     QcDegreesItem* addDegrees(float position);
@@ -75,6 +320,8 @@ public:
     QcLabelItem* addLabel(float position);
     QcGlassItem* addGlass(float position);
     QcAttitudeMeter* addAttitudeMeter(float position);
+    QcDigitalReadoutItem* addDigitalReadout(float position);
+    QcLiteLayer* addLiteLayer();
 
 
     void addItem(QcItem* item, float position);
@@ -82,13 +329,152 @@ public:
     QList <QcItem*> items();
     QList <QcItem*> mItems;
 
+    void invalidateCache();
+
+    void setRenderThreadPool(QThreadPool *pool);
+    QThreadPool* renderThreadPool();
+    void setTileRendering(QThreadPool *pool, int tileSize = 256);
+
+    // quality steps taken in order while paints exceed the frame budget
+    enum Quality{FullQuality,NoMinorTicks,NoDynamicAntialiasing,FlatFills,ReducedFrameRate};
+    enum {QualityFrames=10,ReducedFrameInterval=100};
+    void setFrameBudget(float msecs);
+    float frameBudget();
+    Quality quality();
+    float paintTime();
+
+    bool isExposed();
+    // how long a requested paint may be late before exposure is checked again
+    enum {ExposureCheckInterval=16};
+
+    // 0 detaches the gauge, it then repaints as soon as a value changes
+    void setUpdateScheduler(QcUpdateScheduler *scheduler,
+                            QcUpdateScheduler::Priority priority = QcUpdateScheduler::Normal);
+    QcUpdateScheduler* updateScheduler();
+    QcUpdateScheduler::Priority refreshPriority();
+
+    // time from a sample's acquisition stamp, as passed to QcValueBatch,
+    // to the end of the paint that showed it; per gauge and per channel
+    void setLatencyTracking(bool enabled);
+    bool latencyTracking();
+    QcLatencyHistogram latency();
+    QcLatencyHistogram channelLatency(QcItem *item, int handle = 0);
+    void resetLatency();
+
+    QcRenderStatistics renderStatistics();
+    void resetRenderStatistics();
+    // summed over all gauges, cache bytes include the shared glyph atlases
+    static QcRenderStatistics globalRenderStatistics();
+    static void resetGlobalRenderStatistics();
+
 
 signals:
+    void qualityChanged(int quality);
 
 public slots:
+private slots:
+    void renderFinished();
+
 private:
+    friend class QcItem;
+    friend class QcUpdateScheduler;
+    friend class QcValueBatch;
+    friend class QcFaceCache;
     void paintEvent(QPaintEvent *);
-
+    void showEvent(QShowEvent *);
+    void hideEvent(QHideEvent *);
+    bool eventFilter(QObject *watched, QEvent *event);
+    bool checkExposed();
+    void applyDeferred();
+    void paintItems(QPainter *painter);
+    void ensureFaces();
+    void updateFaces();
+    void evictFaces();
+    void requestFrame();
+    void requestFrame(const QRect &rect);
+    bool snapshotLayers(QVector<QcRenderLayer> &layers);
+    bool startRender();
+    void waitForRender();
+    bool paintTiles(QPainter *painter);
+    void adaptQuality(float msecs);
+    void recordPaintTime(qint64 nsecs);
+    void setQuality(Quality quality);
+    void recordSample(QcItem *item, int handle, qint64 stamp);
+    void recordLatency(QVector<int> &channels, bool rendered);
+    void countUpdate();
+    void countDroppedValue();
+    qint64 cacheBytes();
+
+    // a run of adjacent static items flattened into one image
+    struct Face
+    {
+        int first;
+        int count;
+        QImage image;
+    };
+    QVector<Face> mFaces;
+    QSize mFacesSize;
+    qreal mFacesRatio;
+    bool mFacesValid;
+    QcCacheEntry *mFaceCache;
+
+    // frames rendered on a worker thread from item snapshots
+    QThreadPool *mRenderPool;
+    QcRenderJob *mRenderJob;
+    QImage mFrame;
+    bool mFrameDirty;
+    // the item that returned no snapshot, while it's on the gauge the
+    // others aren't snapshotted either
+    QPointer<QcItem> mSnapshotBlocker;
+
+    QThreadPool *mTilePool;
+    int mTileSize;
+
+    float mFrameBudget;
+    float mPaintTime;
+    Quality mQuality;
+    int mOverBudget;
+    int mUnderBudget;
+    QElapsedTimer mLastFrame;
+    QTimer *mFrameTimer;
+
+    // changes made while hidden, minimized or scrolled out are only stored
+    bool mExposed;
+    bool mDeferred;
+    QElapsedTimer mExposureChecked;
+    QPointer<QWidget> mWatchedWindow;
+
+    QPointer<QcUpdateScheduler> mScheduler;
+    QcUpdateScheduler::Priority mPriority;
+    bool mSchedulePending;
+    bool mScheduleActive;  // requested a frame in the statistics window
+    qint64 mScheduledAt;
+
+    // repaint requested inside an open QcValueBatch
+    bool mBatched;
+    bool mBatchFull;
+    QRect mBatchRect;
+
+    struct LatencyChannel
+    {
+        QcItem *item;
+        int handle;
+        qint64 pending;    // newest sample not painted yet
+        qint64 rendering;  // sample in the frame on the render thread
+        QcLatencyHistogram histogram;
+    };
+    bool mLatencyTracking;
+    bool mFrameFresh;
+    QcLatencyHistogram mLatency;
+    QVector<LatencyChannel> mLatencyChannels;
+    QVector<int> mLatencyPending;
+    QVector<int> mLatencyRendering;
+
+    // cache events also come from render threads, so they are atomic
+    QcRenderStatistics mStatistics;
+    QcCacheCounters *mCacheCounters;
+    QcLatencyHistogram mPaintTimes;
+    bool mUpdatePending;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -102,12 +488,26 @@ public:
     explicit QcItem(QObject *parent = 0);
     virtual void draw(QPainter *) = 0;
     virtual int type();
+    virtual bool isStatic();
+    virtual QcItemSnapshot* snapshot();
 
     void setPosition(float percentage);
     float position();
     QRectF rect();
+    virtual void setQuality(int quality);
+    int quality();
+    virtual void applyDeferred();
+    // the value a QcValueBatch channel sets, handle selects within the item
+    virtual void setChannelValue(int handle, float value);
+    // memory held by the item's own image and path caches
+    virtual qint64 cacheBytes();
     enum Error{InvalidValueRange,InvalidDegreeRange,InvalidStep};
 
+    static QRectF squareRect(const QRect &widgetRect);
+    static QRectF adjustRect(const QRectF &rect, float percentage);
+    static float radius(const QRectF &rect);
+    static QPointF pointAt(float deg, const QRectF &rect);
+
 
 protected:
     QRectF adjustRect(float percentage);
@@ -116,12 +516,794 @@ protected:
     QPointF getPoint(float deg, const QRectF &tmpRect);
     QRectF resetRect();
     void update();
+    void update(const QRectF &rect);
+    void invalidateCache();
+    bool deferChanges();
+    void defer();
+    void dropValue();
 
 private:
+    friend class QcGaugeWidget;
+    friend class QcChannelGraph;
+    friend class QcValueBatch;
     QRectF mRect;
     QWidget *parentWidget;
+    QcGaugeWidget *parentGauge;
     float mPosition;
+    int mQuality;
+};
+
+struct QcChannelValue
+{
+    QcItem *item;
+    int handle;
+    float value;
+    qint64 stamp;  // acquisition time on the QcValueBus::timestamp() clock, 0 if unknown
+};
+
+// Applies value changes across many gauges in one pass. Between begin()
+// and the outermost commit() setters only store their values: label
+// formatting waits for the paint, and every affected gauge gets a single
+// repaint of its merged dirty area at commit. For the GUI thread only.
+class QCGAUGE_DECL QcValueBatch
+{
+public:
+    static void begin();
+    static void commit();
+    static bool isActive();
+    static void apply(const QcChannelValue *values, int count);
+    // stamp of the value apply() is passing on, for items that forward it
+    static qint64 stamp();
+
+private:
+    friend class QcGaugeWidget;
+    static void add(QcGaugeWidget *gauge);
+    static qint64 sStamp;
+    static int sDepth;
+    static QVector<QcGaugeWidget*> sGauges;
 };
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// A table of named float channels in shared memory, written by producer
+// processes and read by the UI without syscalls. Every slot is guarded by
+// a sequence counter (a seqlock): writers make it odd while they store,
+// readers retry when it is odd or changed under them. Items bound to a
+// slot name get the latest value through one QcValueBatch per poll().
+class QCGAUGE_DECL QcValueBus : public QObject
+{
+    Q_OBJECT
+public:
+    enum {NameLength=32};
+
+    explicit QcValueBus(const QString &key, QObject *parent = 0);
+    ~QcValueBus();
+
+    bool create(int capacity);
+    bool attach();
+    void detach();
+    bool isAttached();
+    QString errorString();
+    int slotCount();
+
+    // producer side; slots out of range, -1 from a full bus included,
+    // are ignored by write() and read()
+    int addSlot(const char *name);
+    void write(int slot, float value);
+    void write(int slot, float value, qint64 stamp);
+
+    // consumer side
+    int slot(const char *name);
+    bool read(int slot, float *value, qint64 *stamp = 0);
+    quint32 version(int slot);
+    void bind(const char *name, QcItem *item, int handle = 0);
+    void unbind(QcItem *item);
+    void setPollInterval(int msecs);
+
+    // monotonic nanoseconds, comparable between processes on one host
+    static qint64 timestamp();
+
+public slots:
+    int poll();
+
+private:
+    struct Binding
+    {
+        char name[NameLength];
+        int slot;
+        QPointer<QcItem> item;
+        int handle;
+        quint32 version;
+    };
+    void resolve();
+
+    QSharedMemory *mMemory;
+    QString mError;
+    QVector<Binding> mBindings;
+    QVector<QcChannelValue> mChanged;
+    int mResolvedCount;
+    int mCapacity;  // 0 while detached
+    QTimer *mPollTimer;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Streaming NMEA 0183 reader. Bytes from a serial port, pipe or file are
+// split into sentences in a fixed line buffer, checksummed and cut into
+// fields in place. Values for bound items are coalesced: each feed()
+// applies only the latest value per binding, in one QcValueBatch.
+class QCGAUGE_DECL QcNmeaReader : public QObject
+{
+    Q_OBJECT
+public:
+    enum {MaxSentence=128,MaxFields=32};
+
+    // wind angles are in -180..180, port negative; speeds in knots
+    enum Quantity{ApparentWindAngle,ApparentWindSpeed,TrueWindAngle,TrueWindSpeed,
+                  Heading,WaterSpeed};
+
+    explicit QcNmeaReader(QObject *parent = 0);
+
+    void bind(Quantity quantity, QcItem *item, int handle = 0);
+    // any numeric field, e.g. bind("DPT",1,item) for the depth
+    void bind(const char *formatter, int field, QcItem *item, int handle = 0);
+    void unbind(QcItem *item);
+
+    void setDevice(QIODevice *device);
+    qint64 readFrom(QIODevice *device);
+    void feed(const char *data, int size);
+
+    quint64 sentences();
+    quint64 checksumErrors();
+
+private slots:
+    void readDevice();
+
+private:
+    struct Binding
+    {
+        char formatter[4];
+        int field;
+        int quantity;  // -1 for a plain field
+        QPointer<QcItem> item;
+        int handle;
+        bool pending;
+        float value;
+        qint64 stamp;
+    };
+    void scan(const char *data, int size);
+    void parseSentence(char *sentence, int length);
+    void apply();
+
+    QVector<Binding> mBindings;
+    QVector<QcChannelValue> mChanged;
+    char mLine[MaxSentence];
+    qint64 mReceived;
+    int mLength;
+    bool mOverflow;
+    bool mPending;
+    QIODevice *mDevice;
+    quint64 mSentences;
+    quint64 mChecksumErrors;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Reads a stream of Signal K delta messages. Messages are framed by brace
+// depth as the bytes arrive and scanned once, in place: only the path and
+// the numeric value of each entry under updates[].values[] are picked up,
+// and the path is looked up in a hash index built when items are bound.
+// Values are applied in one QcValueBatch per feed() or readFrom().
+class QCGAUGE_DECL QcSignalKReader : public QObject
+{
+    Q_OBJECT
+public:
+    enum {MaxMessage=1<<20,MaxDepth=32};
+
+    explicit QcSignalKReader(QObject *parent = 0);
+
+    // Signal K values are SI, factor converts them for the gauge,
+    // e.g. 180/M_PI for radians to degrees
+    void bind(const char *path, QcItem *item, int handle = 0, float factor = 1);
+    void unbind(QcItem *item);
+
+    void setDevice(QIODevice *device);
+    qint64 readFrom(QIODevice *device);
+    void feed(const char *data, int size);
+
+    quint64 messages();
+    quint64 errors();
+
+private slots:
+    void readDevice();
+
+private:
+    struct Binding
+    {
+        QByteArray path;
+        quint32 hash;
+        QPointer<QcItem> item;
+        int handle;
+        float factor;
+        bool pending;
+        float value;
+        qint64 stamp;
+    };
+    void scan(const char *data, int size);
+    void parseMessage(const char *begin, const char *end);
+    void setValue(const char *path, int length, double value);
+    void buildIndex();
+    void apply();
+    friend class QcDeltaScanner;
+
+    QVector<Binding> mBindings;
+    QVector<int> mIndex;  // open addressing, binding number or -1
+    QVector<QcChannelValue> mChanged;
+    QVector<char> mMessage;
+    qint64 mReceived;
+    int mDepth;
+    bool mInString;
+    bool mEscape;
+    bool mPending;
+    QIODevice *mDevice;
+    quint64 mMessages;
+    quint64 mErrors;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Derived channels computed from other channels, e.g. true wind:
+//
+//     int awa = graph->addInput("awa"), aws = graph->addInput("aws"), stw = graph->addInput("stw");
+//     int twa = graph->addDerived("twa", {awa,aws,stw}, [](const float *in){ return ...; });
+//     graph->bind(twa, needle);
+//     nmea->bind(QcNmeaReader::ApparentWindAngle, graph->inputItem(), awa);
+//
+// Setting an input only marks its dependents dirty. Once per frame the
+// dirty channels are recomputed in dependency order, but only those with
+// a consumer on an exposed gauge; the others stay dirty until they are
+// shown or their value() is asked for.
+class QCGAUGE_DECL QcChannelGraph : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<float(const float *inputs)> Function;
+    enum {StaleInterval=250};
+
+    explicit QcChannelGraph(QObject *parent = 0);
+
+    int addInput(const char *name, float value = 0);
+    // inputs must already exist, so channels are in dependency order
+    int addDerived(const char *name, const QVector<int> &inputs, const Function &function);
+    int channel(const char *name);
+    int count();
+
+    // unknown channels, such as the -1 of a failed addDerived(), are
+    // ignored; value() returns 0 for them
+    void setValue(int channel, float value, qint64 stamp = 0);
+    float value(int channel);
+    // an item whose setChannelValue() sets the input selected by handle,
+    // for binding the graph to readers and buses
+    QcItem* inputItem();
+
+    void bind(int channel, QcItem *item, int handle = 0);
+    void unbind(QcItem *item);
+    void setFrameInterval(int msecs);
+
+    quint64 computations();
+
+public slots:
+    void evaluate();
+
+private:
+    struct Node
+    {
+        QByteArray name;
+        QVector<int> inputs;
+        QVector<int> dependents;
+        Function function;
+        float value;
+        qint64 stamp;  // newest input sample behind the value
+        bool dirty;
+    };
+    struct Consumer
+    {
+        int channel;
+        QPointer<QcItem> item;
+        int handle;
+        bool sent;
+        float value;
+    };
+    void markDirty(int channel);
+    void compute(int channel);
+    void schedule();
+    static bool isVisible(QcItem *item);
+
+    QVector<Node> mNodes;
+    QVector<Consumer> mConsumers;
+    QVector<char> mNeeded;
+    QVector<QcChannelValue> mChanged;
+    QcItem *mInputItem;
+    QTimer *mTimer;
+    int mFrameInterval;
+    bool mScheduled;
+    quint64 mComputations;
+};
+
+// Copy of an item's state taken on the GUI thread at frame start, drawn
+// on a render thread while the item itself keeps changing. prepare() is
+// called once per frame before any draw() and builds what the state makes
+// lazily; the tiles of a frame then call draw() in parallel, so it must
+// only read the snapshot, or lock what it shares.
+class QCGAUGE_DECL QcItemSnapshot
+{
+public:
+    virtual ~QcItemSnapshot();
+    virtual void prepare(const QRectF &rect, qreal ratio);
+    virtual void draw(QPainter *painter, const QRectF &rect) = 0;
+};
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Generates the tick values of a scale with integer indexed steps, so that
+// float accumulation can't drift or drop the last tick. The tick count is
+// capped to MaxTicks, and the result is cached until an input changes.
+class QCGAUGE_DECL QcTickGenerator
+{
+public:
+    enum {MaxTicks = 1000};
+
+    QcTickGenerator();
+
+    void setRange(float minValue, float maxValue);
+    void setStep(float step);
+    void setLength(float length);
+    void setAutoSpacing(float minSpacing);
+
+    float step();
+    float effectiveStep();
+    float autoSpacing();
+    const QVector<float>& ticks();
+    int revision();
+
+    static float niceStep(float range, int maxCount);
+
+private:
+    void generate();
+
+    float mMinValue;
+    float mMaxValue;
+    float mStep;
+    float mLength;
+    float mMinSpacing;
+    float mEffectiveStep;
+    bool mDirty;
+    int mRevision;
+    QVector<float> mTicks;
+};
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Maps a value to its position along the scale, as a fraction from 0 at
+// minValue to 1 at maxValue. Scales sample nonlinear mappings into a lookup
+// table whenever their range changes, so fraction() is never called per paint.
+class QCGAUGE_DECL QcScaleMapping
+{
+public:
+    virtual ~QcScaleMapping();
+    virtual float fraction(float value, float minValue, float maxValue) const = 0;
+};
+
+class QCGAUGE_DECL QcLogMapping : public QcScaleMapping
+{
+public:
+    float fraction(float value, float minValue, float maxValue) const;
+};
+
+class QCGAUGE_DECL QcSqrtMapping : public QcScaleMapping
+{
+public:
+    float fraction(float value, float minValue, float maxValue) const;
+};
+
+class QCGAUGE_DECL QcPiecewiseMapping : public QcScaleMapping
+{
+public:
+    // pairs of (value, fraction), e.g. a fuel tank calibration table
+    explicit QcPiecewiseMapping(const QList<QPair<float,float> >& points);
+    float fraction(float value, float minValue, float maxValue) const;
+
+private:
+    QList<QPair<float,float> > mPoints;
+};
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Value range, degree range and mapping of a scale. Items share a scale through
+// QSharedPointer, so one range change updates all of them; revision() lets each
+// item tell whether the caches it built from the scale are still valid.
+class QCGAUGE_DECL QcScale : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QcScale(QObject *parent = 0);
+
+    void setValueRange(float minValue,float maxValue);
+    void setDegreeRange(float minDegree,float maxDegree);
+    void setMinValue(float minValue);
+    void setMaxValue(float maxValue);
+    void setMinDegree(float minDegree);
+    void setMaxDegree(float maxDegree);
+    void setDegreeOffset(float degreeOffset);
+    void setMapping(const QSharedPointer<QcScaleMapping>& mapping);
+
+    float minValue() const;
+    float maxValue() const;
+    float minDegree() const;
+    float maxDegree() const;
+    float degreeOffset() const;
+    QSharedPointer<QcScaleMapping> mapping() const;
+    int revision() const;
+
+    float degFromValue(float value) const;
+    void degFromValues(const float *values, float *degrees, int count) const;
+    void copyFrom(const QcScale &other);
+
+    enum {MappingTableSize = 256};
+
+signals:
+    void changed();
+
+private:
+    void updateMapping();
+
+    float mMinValue;
+    float mMaxValue;
+    float mMinDegree;
+    float mMaxDegree;
+    float mDegreeOffset;
+    int mRevision;
+
+    QSharedPointer<QcScaleMapping> mMapping;
+    float mSlope;
+    float mIntercept;
+    float mTableScale;
+    QVector<float> mTable;
+};
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Plain, copyable state of the built-in items. The QObject items draw
+// through these, and QcLiteLayer stores them contiguously without a QObject
+// per item. rect is the square gauge rect, position is in percent of it.
+// Where draw() is split into prepare() and paint(), prepare() builds the
+// lazily made state and paint() only reads it, or locks a shared cache;
+// a snapshot prepares once and paints from several tiles at once.
+struct QCGAUGE_DECL QcBackgroundState
+{
+    QcBackgroundState();
+    void draw(QPainter *painter, const QRectF &rect);
+
+    float position;
+    QPen pen;
+    QList<QPair<float,QColor> > colors;
+    int quality; // QcGaugeWidget::Quality
+
+private:
+    // the gradient is built again only when its inputs change
+    QBrush brush;
+    QRectF brushRect;
+    QList<QPair<float,QColor> > brushColors;
+    bool brushFlat;
+};
+
+struct QCGAUGE_DECL QcGlassState
+{
+    QcGlassState();
+    void draw(QPainter *painter, const QRectF &rect);
+
+    float position;
+    int quality; // QcGaugeWidget::Quality
+
+private:
+    QBrush brush;
+    QRectF brushRect;
+    bool brushFlat;
+};
+
+struct QCGAUGE_DECL QcArcState
+{
+    QcArcState();
+    void draw(QPainter *painter, const QRectF &rect, const QcScale &scale);
+    void prepare(const QRectF &rect, const QcScale &scale, qreal ratio);
+    void paint(QPainter *painter, const QRectF &rect, const QcScale &scale) const;
+
+    float position;
+    QColor color;
+
+private:
+    QPen pen;
+};
+
+struct QCGAUGE_DECL QcColorBandState
+{
+    QcColorBandState();
+    void draw(QPainter *painter, const QRectF &rect, const QcScale &scale);
+    void prepare(const QRectF &rect, const QcScale &scale, qreal ratio);
+    void paint(QPainter *painter, const QRectF &rect, const QcScale &scale) const;
+    qint64 cacheBytes() const;
+
+    float position;
+    QList<QPair<QColor,float> > colors;
+
+private:
+    // stroked outline of each band, rebuilt when its arc moves
+    struct Segment
+    {
+        float from;
+        float sweep;
+        QPainterPath outline;
+        QBrush fill;
+    };
+    // the outlines for rect, built under the cache lock when missing
+    QVector<Segment> segments(const QRectF &rect, const QcScale &scale) const;
+
+    struct Cache : public QcCacheEntry
+    {
+        Cache() : QcCacheEntry(QcRenderStatistics::BandCache) {}
+        void evict();
+        void account();
+        QVector<Segment> segments;
+        QRectF rect;
+        float width;
+        QMutex mutex; // tiles may draw copies at once
+    };
+    QSharedPointer<Cache> d;
+};
+
+struct QCGAUGE_DECL QcDegreesState
+{
+    QcDegreesState();
+    void draw(QPainter *painter, const QRectF &rect, const QcScale &scale);
+    void prepare(const QRectF &rect, const QcScale &scale, qreal ratio);
+    void paint(QPainter *painter, const QRectF &rect, const QcScale &scale) const;
+
+    float position;
+    QColor color;
+    bool subDegree;
+    QcTickGenerator ticks;
+    QVector<float> tickDegrees;
+    int ticksRevision;
+    int scaleRevision;
+    int quality; // QcGaugeWidget::Quality
+
+private:
+    // tick marks as lines, laid out when the ticks, scale or rect change
+    QVector<QLineF> tickLines;
+    QRectF linesRect;
+    QPen pen;
+    float penWidth;
+};
+
+struct QCGAUGE_DECL QcValuesState
+{
+    QcValuesState();
+    void draw(QPainter *painter, const QRectF &rect, const QcScale &scale);
+    void prepare(const QRectF &rect, const QcScale &scale, qreal ratio);
+    void paint(QPainter *painter, const QRectF &rect, const QcScale &scale) const;
+
+    float position;
+    QColor color;
+    QString font;
+    QcTickGenerator ticks;
+    QVector<float> tickDegrees;
+    int ticksRevision;
+    int scaleRevision;
+
+private:
+    // numbers are formatted on the stack and blitted from the atlas
+    QVector<float> tickValues;
+    QFont textFont;
+    QString textFontFamily;
+    float textFontSize;
+    QSharedPointer<QcGlyphAtlas> atlas;
+};
+
+struct QcNeedleState;
+
+// Needle images prerendered at count() discrete angles, so a frame blits
+// one sprite instead of rasterizing the needle. Sprites are rendered on
+// first use and dropped when the needle size, shape or color changes.
+class QCGAUGE_DECL QcNeedleSprites
+{
+public:
+    QcNeedleSprites();
+    // the state must be prepared for r
+    void draw(QPainter *painter, const QcNeedleState &state, const QPointF &center, float r, float deg) const;
+    void clear();
+    qint64 cacheBytes() const;
+
+    int count;     // 0 disables the sprites
+    bool blending; // crossfades the sprites on both sides of the angle
+
+private:
+    void render(const QcNeedleState &state, int index) const;
+    void blend(int first, int second, int weight) const;
+
+    // copies of a state share the rendered sprites
+    struct Cache : public QcCacheEntry
+    {
+        Cache() : QcCacheEntry(QcRenderStatistics::SpriteCache) {}
+        void evict();
+        void clear();
+        QVector<QImage> sprites;
+        QVector<QPoint> offsets;
+        float radius;
+        int needleType;
+        QColor color;
+        qreal ratio;
+        // the last crossfade, grown to the largest one so far
+        QImage blend;
+        QRect blendRect;
+        int blendFirst;
+        int blendSecond;
+        int blendWeight;
+        QMutex mutex;
+    };
+    QSharedPointer<Cache> d;
+};
+
+struct QCGAUGE_DECL QcNeedleState
+{
+    QcNeedleState();
+    void draw(QPainter *painter, const QRectF &rect, const QcScale &scale);
+    void prepare(const QRectF &rect, const QcScale &scale, qreal ratio);
+    void paint(QPainter *painter, const QRectF &rect, const QcScale &scale) const;
+    // around the painter origin, with the polygon and brush of the last prepare()
+    void drawNeedle(QPainter *painter, float rotation) const;
+    void createNeedle(float r);
+
+    float position;
+    float currentValue;
+    QColor color;
+    int needleType; // QcNeedleItem::NeedleType
+    QPolygonF needlePoly;
+    QcNeedleSprites sprites;
+    int quality; // QcGaugeWidget::Quality
+
+private:
+    // the polygon and brush are remade only when the needle changes
+    float polyRadius;
+    int polyType;
+    QBrush brush;
+    QColor brushColor;
+    bool brushGradient;
+};
+
+// Prerendered glyphs of the numeric characters for one font, color and
+// device pixel ratio. Numeric strings are laid out and blitted from the
+// atlas image without text shaping.
+class QCGAUGE_DECL QcGlyphAtlas : public QcCacheEntry
+{
+public:
+    QcGlyphAtlas(const QFont &font, const QColor &color, qreal ratio);
+    static QSharedPointer<QcGlyphAtlas> atlas(const QFont &font, const QColor &color, qreal ratio);
+    static int format(float value, int decimals, char *buffer, int size);
+    // bytes of all atlases in the shared registry
+    static qint64 cachedBytes();
+
+    bool matches(const QFont &font, const QColor &color, qreal ratio) const;
+    bool contains(const QString &text) const;
+    QSizeF size(const char *text, int length) const;
+    QSizeF size(const QString &text) const;
+    void draw(QPainter *painter, const QPointF &topLeft, const char *text, int length) const;
+    void draw(QPainter *painter, const QPointF &topLeft, const QString &text) const;
+
+private:
+    struct Glyph
+    {
+        QRectF source;
+        float advance;
+    };
+    int glyph(ushort c) const;
+    void evict();
+    // the image again after an eviction, the layout is kept
+    void render();
+    QImage pixels() const;
+
+    QFont mFont;
+    QColor mColor;
+    qreal mRatio;
+    mutable QMutex mMutex;
+    QImage mImage;
+    QVector<Glyph> mGlyphs;
+    int mIndex[128];
+    float mPadding;
+    float mHeight;
+};
+
+struct QCGAUGE_DECL QcLabelState
+{
+    QcLabelState();
+    void draw(QPainter *painter, const QRectF &rect);
+    void prepare(const QRectF &rect, qreal ratio);
+    void paint(QPainter *painter, const QRectF &rect) const;
+    void setValue(float value, int decimals = -1);
+    QString displayText() const;
+
+    float position;
+    float angle;
+    QString text;
+    QColor color;
+    QString font;
+    char digits[32];  // formatted by setValue(), drawn from the glyph atlas
+    int digitsLength; // -1 when text is shown
+    QSharedPointer<QcGlyphAtlas> atlas;
+
+private:
+    // other text is laid out once, when it or the font changes
+    QFont textFont;
+    QString textFontFamily;
+    float textFontSize;
+    QStaticText staticText;
+    QPen pen;
+};
+// Digits drawn from prerendered cell images. Each frame only the cells
+// whose character changed are copied into the cached readout image.
+struct QCGAUGE_DECL QcDigitalReadoutState
+{
+    QcDigitalReadoutState();
+    void draw(QPainter *painter, const QRectF &rect);
+    void prepare(const QRectF &rect, qreal ratio);
+    void paint(QPainter *painter, const QRectF &rect) const;
+    void setValue(float value, int decimals = -1);
+    QRectF readoutRect(const QRectF &rect) const;
+    QRectF cellRect(const QRectF &rect, int cell) const;
+    qint64 cacheBytes() const;
+
+    float position;
+    float angle;
+    float digitHeight; // percentage of the gauge radius
+    int digitCount;
+    int style;         // QcDigitalReadoutItem::Style
+    QColor color;
+    QColor offColor;   // unlit segments, transparent to hide them
+    QVector<uchar> cells;
+
+private:
+    void renderGlyphs(const QSize &size) const;
+    void renderGlyph(QPainter *painter, const QSizeF &size, int code) const;
+
+    // copies of a state share the rendered cells
+    struct Cache : public QcCacheEntry
+    {
+        Cache() : QcCacheEntry(QcRenderStatistics::ReadoutCache) {}
+        void evict();
+        void account();
+        QVector<QImage> glyphs;
+        QImage frame;
+        QVector<uchar> frameCells;
+        int style;
+        QColor color;
+        QColor offColor;
+        qreal ratio;
+        QMutex mutex;
+    };
+    QSharedPointer<Cache> d;
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -139,21 +1321,39 @@ public:
     void setMinDegree(float minDegree);
     void setMaxDegree(float maxDegree);
     void setDegreeOffset(float degreeOffset);
+    void setMapping(const QSharedPointer<QcScaleMapping>& mapping);
+    QSharedPointer<QcScaleMapping> mapping();
+
+    void setScale(const QSharedPointer<QcScale>& scale);
+    QSharedPointer<QcScale> scale();
+
+    float minValue() const;
+    float maxValue() const;
+    float minDegree() const;
+    float maxDegree() const;
+    float degreeOffset() const;
 
 signals:
 
 public slots:
+protected slots:
+    virtual void scaleChanged();
+
 protected:
 
     float getDegFromValue(float) const;
     float getDegFromValue();
+    void getDegFromValues(const float *values, float *degrees, int count) const;
+    // the item's scale, or the defaults while it has none of its own
+    const QcScale &currentScale() const;
+    // for snapshots; GUI thread only
+    QSharedPointer<QcScale> scaleCopy();
 
-    float mMinValue;
-    float mMaxValue;
-    float mMinDegree;
-    float mMaxDegree;
-    float mDegreeOffset;
-
+private:
+    QcScale *ownScale();
+    // made on the first setter, so items given a shared scale never have one
+    QSharedPointer<QcScale> mScale;
+    QSharedPointer<QcScale> mScaleCopy;
 };
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -165,14 +1365,13 @@ class QCGAUGE_DECL QcBackgroundItem : public QcItem
 public:
     explicit QcBackgroundItem(QObject *parent = 0);
     void draw(QPainter*);
+    bool isStatic();
     void addColor(float position, const QColor& color);
     void clearrColors();
 
 
 private:
-    QPen mPen;
-    QList<QPair<float,QColor> > mColors;
-    QLinearGradient mLinearGrad;
+    QcBackgroundState mState;
 };
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -184,6 +1383,10 @@ class QcGlassItem : public QcItem
 public:
     explicit QcGlassItem(QObject *parent = 0);
     void draw(QPainter*);
+    bool isStatic();
+
+private:
+    QcGlassState mState;
 };
 
 
@@ -198,9 +1401,11 @@ class QCGAUGE_DECL QcLabelItem : public QcItem
 public:
     explicit QcLabelItem(QObject *parent = 0);
     virtual void draw(QPainter *);
+    QcItemSnapshot* snapshot();
     void setAngle(float);
     float angle();
     void setText(const QString &text, bool repaint = true);
+    void setValue(float value, int decimals = -1, bool repaint = true);
     QString text();
     void setColor(const QColor& color);
     QColor color();
@@ -208,10 +1413,7 @@ public:
     QString font();
 
 private:
-    float mAngle;
-    QString mText;
-    QColor mColor;
-    QString mFont;
+    QcLabelState mState;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -224,10 +1426,11 @@ class QCGAUGE_DECL QcArcItem : public QcScaleItem
 public:
     explicit QcArcItem(QObject *parent = 0);
     void draw(QPainter*);
+    QcItemSnapshot* snapshot();
     void setColor(const QColor& color);
 
 private:
-    QColor mColor;
+    QcArcState mState;
 
 signals:
 
@@ -245,12 +1448,12 @@ class QCGAUGE_DECL QcColorBand : public QcScaleItem
 public:
     explicit QcColorBand(QObject *parent = 0);
     void draw(QPainter*);
+    QcItemSnapshot* snapshot();
     void setColors(const QList<QPair<QColor,float> >& colors);
+    qint64 cacheBytes();
 
 private:
-   QPainterPath createSubBand(float from,float sweep);
-
-   QList<QPair<QColor,float> > mBandColors;
+    QcColorBandState mState;
 };
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -261,13 +1464,13 @@ class QCGAUGE_DECL QcDegreesItem : public QcScaleItem
 public:
     explicit QcDegreesItem(QObject *parent = 0);
     void draw(QPainter *painter);
+    QcItemSnapshot* snapshot();
     void setStep(float step);
+    void setAutoSpacing(float minSpacing);
     void setColor(const QColor& color);
     void setSubDegree(bool );
 private:
-    float mStep;
-    QColor mColor;
-    bool mSubDegree;
+    QcDegreesState mState;
 };
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -279,6 +1482,7 @@ class QCGAUGE_DECL QcNeedleItem : public QcScaleItem
 public:
     explicit QcNeedleItem(QObject *parent = 0);
     void draw(QPainter*);
+    QcItemSnapshot* snapshot();
     void setCurrentValue(float value);
     float currentValue();
     void setValueFormat(QString format);
@@ -292,18 +1496,20 @@ public:
     enum NeedleType{DiamonNeedle,TriangleNeedle,FeatherNeedle,AttitudeMeterNeedle,CompassNeedle};//#
 
     void setNeedle(QcNeedleItem::NeedleType needleType);
+
+    enum {MaxSprites=3600};
+    void setSpriteCount(int count);
+    int spriteCount();
+    void setSpriteBlending(bool blending);
+    void setChannelValue(int handle, float value);
+    void applyDeferred();
+    qint64 cacheBytes();
 private:
-    QPolygonF mNeedlePoly;
-    float mCurrentValue;
-    QColor mColor;
-    void createDiamonNeedle(float r);
-    void createTriangleNeedle(float r);
-    void createFeatherNeedle(float r);
-    void createAttitudeNeedle(float r);
-    void createCompassNeedle(float r);
-    NeedleType mNeedleType;
+    QcNeedleState mState;
     QcLabelItem *mLabel;
     QString mFormat;
+    bool mLabelDeferred;
+    bool mLabelStale;
 };
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -316,16 +1522,16 @@ class QCGAUGE_DECL QcValuesItem : public QcScaleItem
 public:
     explicit QcValuesItem(QObject *parent = 0);
     void draw(QPainter*);
+    QcItemSnapshot* snapshot();
     void setStep(float step);
     float step();
+    void setAutoSpacing(float minSpacing);
     void setColor(const QColor& color);
     QColor color();
     void setFont(const QString &font);
     QString font();
 private:
-    float mStep;
-    QColor mColor;
-    QString mFont;
+    QcValuesState mState;
 };
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -364,9 +1570,170 @@ private:
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 
+class QCGAUGE_DECL QcDigitalReadoutItem : public QcItem
+{
+    Q_OBJECT
+public:
+    explicit QcDigitalReadoutItem(QObject *parent = 0);
+    void draw(QPainter *);
+    QcItemSnapshot* snapshot();
+
+    enum Style{SevenSegment,PlainDigits};
+    enum {MaxDigits=32};
+
+    void setValue(float value, int decimals = -1);
+    float value();
+    void setDigitCount(int count);
+    int digitCount();
+    void setDigitHeight(float percentage);
+    void setAngle(float angle);
+    void setStyle(Style style);
+    void setColor(const QColor &color);
+    QColor color();
+    void setOffColor(const QColor &color);
+    void setChannelValue(int handle, float value);
+    void applyDeferred();
+    qint64 cacheBytes();
+
+private:
+    QcDigitalReadoutState mState;
+    float mValue;
+    int mDecimals;
+    bool mCellsDeferred;
+};
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Holds many built-in items in contiguous per-kind storage and draws them
+// with a switch on their kind, without a QObject or heap block per item.
+// Items are addressed by the handle returned when they are added; facade()
+// wraps one in a QObject only when signals or properties are needed.
+class QCGAUGE_DECL QcLiteLayer : public QcItem
+{
+    Q_OBJECT
+public:
+    explicit QcLiteLayer(QObject *parent = 0);
+    void draw(QPainter *painter);
+    QcItemSnapshot* snapshot();
+
+    // Invalid is only the kind() of a handle the layer doesn't have
+    enum Kind{Arc,Degrees,Values,Needle,Label,Invalid};
+
+    int addScale(const QSharedPointer<QcScale>& scale);
+    // -1 if scale isn't an index returned by addScale()
+    int addArc(float position, int scale);
+    int addDegrees(float position, int scale, float step);
+    int addValues(float position, int scale, float step);
+    int addNeedle(float position, int scale);
+    int addLabel(float position, const QString &text);
+    void clear();
+
+    int count();
+    Kind kind(int handle);
+    QSharedPointer<QcScale> scale(int handle);
+
+    // Handles not returned by the add methods, such as their -1, are
+    // ignored by the setters; getters return defaults, the state accessors
+    // a scratch state, and facade() 0.
+
+    // direct access to the state, for configuration
+    QcArcState& arc(int handle);
+    QcDegreesState& degrees(int handle);
+    QcValuesState& values(int handle);
+    QcNeedleState& needle(int handle);
+    QcLabelState& label(int handle);
+
+    void setCurrentValue(int needle, float value);
+    float currentValue(int needle);
+    void setText(int label, const QString &text);
+    void setColor(int handle, const QColor &color);
+    QColor color(int handle);
+    void setLabel(int needle, int label);
+
+    QcLiteItemFacade* facade(int handle);
+    void setQuality(int quality);
+    void setChannelValue(int handle, float value);
+    void applyDeferred();
+    qint64 cacheBytes();
+
+private slots:
+    void scaleChanged();
+
+private:
+    friend class QcLiteLayerSnapshot;
+
+    struct Entry
+    {
+        Kind kind;
+        int index;
+        int scale;
+        int label;
+    };
+    // shared by the layer and its snapshots, which hold copies of the vectors
+    static void prepareEntries(const QRectF &rect, qreal ratio, const QVector<Entry> &entries,
+                               const QVector<QSharedPointer<QcScale> > &scales,
+                               QVector<QcArcState> &arcs, QVector<QcDegreesState> &degrees,
+                               QVector<QcValuesState> &values, QVector<QcNeedleState> &needles,
+                               QVector<QcLabelState> &labels);
+    static void drawEntries(QPainter *painter, const QRectF &rect, const QVector<Entry> &entries,
+                            const QVector<QSharedPointer<QcScale> > &scales,
+                            const QVector<QcArcState> &arcs, const QVector<QcDegreesState> &degrees,
+                            const QVector<QcValuesState> &values, const QVector<QcNeedleState> &needles,
+                            const QVector<QcLabelState> &labels);
+    int addEntry(Kind kind, int index, int scale);
+    bool isEntry(int handle, Kind kind);
+    void setLabelValue(const Entry &needle, float value);
+
+    QVector<Entry> mEntries;
+    QVector<QSharedPointer<QcScale> > mScales;
+    // frozen copies of mScales for the snapshots, made again after a change
+    QVector<QSharedPointer<QcScale> > mScaleCopies;
+    QVector<QcArcState> mArcs;
+    QVector<QcDegreesState> mDegrees;
+    QVector<QcValuesState> mValues;
+    QVector<QcNeedleState> mNeedles;
+    QVector<QcLabelState> mLabels;
+    QHash<int,QcLiteItemFacade*> mFacades;
+    bool mLabelsDeferred;
+};
+
+class QCGAUGE_DECL QcLiteItemFacade : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(float currentValue READ currentValue WRITE setCurrentValue NOTIFY currentValueChanged)
+    Q_PROPERTY(QString text READ text WRITE setText NOTIFY textChanged)
+    Q_PROPERTY(QColor color READ color WRITE setColor)
+public:
+    QcLiteItemFacade(QcLiteLayer *layer, int handle);
+
+    int handle();
+    float currentValue();
+    QString text();
+    QColor color();
+
+public slots:
+    void setCurrentValue(float value);
+    void setText(const QString &text);
+    void setColor(const QColor &color);
+
+signals:
+    void currentValueChanged(float value);
+    void textChanged(const QString &text);
+
+private:
+    QcLiteLayer *mLayer;
+    int mHandle;
+};
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
 class QCGAUGE_DECL QcBar : public QWidget {
     Q_OBJECT
 public:
+    enum {RulerTickSpacing = 4}; // least pixels between ruler ticks
+
     enum DirectionEnum
     {
         Horizontal,
@@ -386,6 +1753,9 @@ protected:
     void drawRulerBottom(QPainter *painter);
     void drawRulerLeft(QPainter *painter);
     void drawRulerRight(QPainter *painter);
+    const QVector<float>& rulerTicks(double length);
+    // value steps of the long and the middle ticks for the last rulerTicks()
+    void rulerSteps(double *longValue, double *halfValue);
 
 private:
     DirectionEnum direction= DirectionEnum::Horizontal; //direction
@@ -403,6 +1773,7 @@ private:
     QColor bgColor; //background color
     QColor lineColor; //Line color
     QColor progressColor; // progress color
+    QcTickGenerator ticks; //ruler tick values
 
     double currentValue; //current value
 
@@ -0,0 +1,160 @@
+/***************************************************************************
+**                                                                        **
+**  QcGauge, for instrumentation, and real time data measurement          **
+**  visualization widget for Qt.                                          **
+**  Copyright (C) 2015 Hadj Tahar Berrima                                 **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU Lesser General Public License as        **
+**  published by the Free Software Foundation, either version 3 of the    **
+**  License, or (at your option) any later version.                       **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU Lesser General Public License for more details.                   **
+**                                                                        **
+**  You should have received a copy of the GNU Lesser General Public      **
+**  License along with this program.                                      **
+**  If not, see http://www.gnu.org/licenses/.                             **
+**                                                                        **
+****************************************************************************/
+
+#ifndef QCSTATICGAUGE_H
+#define QCSTATICGAUGE_H
+
+#include <QStyleOption>
+#include "qcgaugewidget.h"
+
+// A gauge whose item list is fixed at compile time, e.g.
+//
+//     QcStaticGauge<QcBackgroundState, QcDegreesState, QcValuesState, QcNeedleState> gauge;
+//     gauge.item<3>().currentValue = 42;
+//
+// The item states are stored inline in one object and drawn in order by
+// non-virtual calls, through the same draw() as the QcGaugeWidget items.
+// All scale items share the gauge scale().
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename State>
+inline void qcStaticDraw(State &state, QPainter *painter, const QRectF &rect, const QcScale &scale)
+{
+    state.draw(painter,rect,scale);
+}
+
+inline void qcStaticDraw(QcBackgroundState &state, QPainter *painter, const QRectF &rect, const QcScale &)
+{
+    state.draw(painter,rect);
+}
+
+inline void qcStaticDraw(QcGlassState &state, QPainter *painter, const QRectF &rect, const QcScale &)
+{
+    state.draw(painter,rect);
+}
+
+inline void qcStaticDraw(QcLabelState &state, QPainter *painter, const QRectF &rect, const QcScale &)
+{
+    state.draw(painter,rect);
+}
+
+inline void qcStaticDraw(QcDigitalReadoutState &state, QPainter *painter, const QRectF &rect, const QcScale &)
+{
+    state.draw(painter,rect);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename... Items>
+struct QcStaticItems;
+
+template<>
+struct QcStaticItems<>
+{
+    inline void draw(QPainter *, const QRectF &, const QcScale &)
+    {
+    }
+};
+
+template<typename Head, typename... Tail>
+struct QcStaticItems<Head, Tail...> : QcStaticItems<Tail...>
+{
+    Head item;
+
+    inline void draw(QPainter *painter, const QRectF &rect, const QcScale &scale)
+    {
+        qcStaticDraw(item,painter,rect,scale);
+        QcStaticItems<Tail...>::draw(painter,rect,scale);
+    }
+};
+
+template<int N, typename... Items>
+struct QcStaticItemAt;
+
+template<typename Head, typename... Tail>
+struct QcStaticItemAt<0, Head, Tail...>
+{
+    typedef Head Type;
+    typedef QcStaticItems<Head, Tail...> Node;
+};
+
+template<int N, typename Head, typename... Tail>
+struct QcStaticItemAt<N, Head, Tail...> : QcStaticItemAt<N-1, Tail...>
+{
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename... Items>
+class QcStaticGauge : public QWidget
+{
+public:
+    explicit QcStaticGauge(QWidget *parent = 0) :
+        QWidget(parent)
+    {
+        setMinimumSize(250,250);
+        QObject::connect(&mScale,&QcScale::changed,this,static_cast<void (QWidget::*)()>(&QWidget::update));
+    }
+
+    QcScale& scale()
+    {
+        return mScale;
+    }
+
+    template<int N>
+    typename QcStaticItemAt<N, Items...>::Type& item()
+    {
+        typedef typename QcStaticItemAt<N, Items...>::Node Node;
+        return static_cast<Node&>(mItems).item;
+    }
+
+    // draws the items into any paint device, rect is the target widget rect
+    inline void paint(QPainter *painter, const QRect &rect)
+    {
+        mItems.draw(painter,QcItem::squareRect(rect),mScale);
+    }
+
+protected:
+    void paintEvent(QPaintEvent *)
+    {
+        QStyleOption opt;
+        opt.init(this);
+        QPainter painter(this);
+        style()->drawPrimitive(QStyle::PE_Widget, &opt, &painter, this);
+        painter.setRenderHint(QPainter::Antialiasing);
+
+        paint(&painter,rect());
+    }
+
+private:
+    QcScale mScale;
+    QcStaticItems<Items...> mItems;
+};
+
+#endif // QCSTATICGAUGE_H
@@ -29,17 +29,464 @@
 
 
 #include <QStyleOption>
+#include <QThreadPool>
+#include <QThread>
+#include <QSemaphore>
+#include <QMutex>
+#include <QTimer>
+#include <QCoreApplication>
+#include <QFile>
+#include <QSharedMemory>
+#include <QVarLengthArray>
 #include <search.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
 #include "qcgaugewidget.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 
+enum QcCacheEvent{QcCacheHit,QcCacheMiss,QcCacheRebuild,QcCacheEvents};
+
+struct QcCacheCounters
+{
+    QcCacheCounters(QcGaugeWidget *gauge = 0) : gauge(gauge)
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for(int e=0;e<QcCacheEvents;e++)
+            for(int c=0;c<QcRenderStatistics::CacheCount;c++)
+                events[e][c].store(0,std::memory_order_relaxed);
+    }
+
+    void copyTo(QcRenderStatistics &s) const
+    {
+        for(int c=0;c<QcRenderStatistics::CacheCount;c++){
+            s.cacheHits[c] = events[QcCacheHit][c].load(std::memory_order_relaxed);
+            s.cacheMisses[c] = events[QcCacheMiss][c].load(std::memory_order_relaxed);
+            s.cacheRebuilds[c] = events[QcCacheRebuild][c].load(std::memory_order_relaxed);
+        }
+    }
+
+    QcGaugeWidget *gauge;
+    std::atomic<quint64> events[QcCacheEvents][QcRenderStatistics::CacheCount];
+};
+
+static QcCacheCounters qcGlobalCache;
+static QcRenderStatistics qcGlobalStatistics;
+static QcLatencyHistogram qcGlobalPaintTimes;
+static QVector<QcGaugeWidget*> qcGauges;
+
+// the gauge whose frame this thread is drawing, set for the paint and
+// for the render and tile jobs
+static thread_local QcCacheCounters *qcCacheCounters = 0;
+
+class QcCacheCountersScope
+{
+public:
+    QcCacheCountersScope(QcCacheCounters *counters) : mPrevious(qcCacheCounters)
+    {
+        qcCacheCounters = counters;
+    }
+    ~QcCacheCountersScope()
+    {
+        qcCacheCounters = mPrevious;
+    }
+
+private:
+    QcCacheCounters *mPrevious;
+};
+
+static inline void qcCountCache(QcRenderStatistics::Cache cache, QcCacheEvent event)
+{
+    qcGlobalCache.events[event][cache].fetch_add(1,std::memory_order_relaxed);
+    if(qcCacheCounters)
+        qcCacheCounters->events[event][cache].fetch_add(1,std::memory_order_relaxed);
+}
+
+static inline qint64 qcImageBytes(const QImage &image)
+{
+    return qint64(image.bytesPerLine())*image.height();
+}
+
+static void qcPaintTimes(QcRenderStatistics &s, const QcLatencyHistogram &times)
+{
+    s.averagePaintTime = times.mean()/1000.0;
+    s.p99PaintTime = times.percentile(0.99)/1000.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// The registry is only walked to trim, sizes and use times are atomics so
+// render threads account their caches without taking qcCacheMutex. Entries
+// are made on any thread but, like the snapshots holding them, destroyed
+// on the GUI thread, where trimming happens as well.
+static QVector<QcCacheEntry*> qcCacheEntries;
+static QMutex qcCacheMutex;
+static std::atomic<qint64> qcCacheBudget(0);
+static std::atomic<qint64> qcCacheUsage(0);
+static std::atomic<qint64> qcCachePeak(0);
+static std::atomic<qint64> qcCacheKindUsage[QcRenderStatistics::CacheCount];
+static std::atomic<quint64> qcCacheEvictions(0);
+// frame intervals of the monotonic clock, set at every paint; gauges
+// painted in one pass read the same or neighbouring values. A timer per
+// pass would be cleaner but allocates in the event dispatcher.
+static const qint64 qcCacheFrameNanos = 16000000;
+static std::atomic<quint64> qcCacheClock(0);
+
+static void qcCacheFrame()
+{
+    qcCacheClock.store(quint64(QcValueBus::timestamp()/qcCacheFrameNanos),std::memory_order_relaxed);
+}
+
+QcCacheEntry::QcCacheEntry(QcRenderStatistics::Cache kind) :
+    mKind(kind), mBytes(0), mLastUse(0), mOwner(0)
+{
+    QcCacheManager::add(this);
+}
+
+QcCacheEntry::~QcCacheEntry()
+{
+    QcCacheManager::remove(this);
+}
+
+qint64 QcCacheEntry::cacheBytes() const
+{
+    return mBytes.load(std::memory_order_relaxed);
+}
+
+void QcCacheEntry::touch()
+{
+    mLastUse.store(qcCacheClock.load(std::memory_order_relaxed),std::memory_order_relaxed);
+    if(qcCacheCounters)
+        mOwner.store(qcCacheCounters,std::memory_order_relaxed);
+}
+
+void QcCacheEntry::setCacheBytes(qint64 bytes)
+{
+    qint64 old = mBytes.exchange(bytes,std::memory_order_relaxed);
+    if(old!=bytes)
+        QcCacheManager::resize(this,bytes-old);
+}
+
+void QcCacheManager::setBudget(qint64 bytes)
+{
+    qcCacheBudget.store(qMax(bytes,qint64(0)));
+    trim();
+}
+
+qint64 QcCacheManager::budget()
+{
+    return qcCacheBudget.load();
+}
+
+qint64 QcCacheManager::usage()
+{
+    return qcCacheUsage.load();
+}
+
+qint64 QcCacheManager::usage(QcRenderStatistics::Cache kind)
+{
+    return qcCacheKindUsage[kind].load();
+}
+
+qint64 QcCacheManager::peakUsage()
+{
+    return qcCachePeak.load();
+}
+
+quint64 QcCacheManager::evictions()
+{
+    return qcCacheEvictions.load();
+}
+
+void QcCacheManager::add(QcCacheEntry *entry)
+{
+    QMutexLocker locker(&qcCacheMutex);
+    qcCacheEntries.append(entry);
+}
+
+void QcCacheManager::remove(QcCacheEntry *entry)
+{
+    QMutexLocker locker(&qcCacheMutex);
+    qcCacheEntries.removeOne(entry);
+    resize(entry,-entry->mBytes.exchange(0));
+}
+
+void QcCacheManager::resize(QcCacheEntry *entry, qint64 delta)
+{
+    qcCacheKindUsage[entry->mKind].fetch_add(delta,std::memory_order_relaxed);
+    qint64 usage = qcCacheUsage.fetch_add(delta,std::memory_order_relaxed)+delta;
+    qint64 peak = qcCachePeak.load(std::memory_order_relaxed);
+    while(usage>peak && !qcCachePeak.compare_exchange_weak(peak,usage,std::memory_order_relaxed))
+        ;
+}
+
+void QcCacheManager::forget(QcCacheCounters *owner)
+{
+    // caches outliving their gauge, shared atlases mostly, count as shown
+    QMutexLocker locker(&qcCacheMutex);
+    for(int i=0;i<qcCacheEntries.size();i++){
+        QcCacheCounters *expected = owner;
+        qcCacheEntries[i]->mOwner.compare_exchange_strong(expected,0);
+    }
+}
+
+void QcCacheManager::trimIfNeeded()
+{
+    qint64 budget = qcCacheBudget.load(std::memory_order_relaxed);
+    if(budget>0 && qcCacheUsage.load(std::memory_order_relaxed)>budget)
+        trim();
+}
+
+int QcCacheManager::trim()
+{
+    QMutexLocker locker(&qcCacheMutex);
+    qint64 budget = qcCacheBudget.load();
+    if(budget<=0 || qcCacheUsage.load()<=budget)
+        return 0;
+    QC_TRACE_SCOPE("trimCaches","cache");
+
+    struct Candidate
+    {
+        QcCacheEntry *entry;
+        bool hidden;
+        quint64 lastUse;
+        bool operator<(const Candidate &other) const
+        {
+            if(hidden!=other.hidden)
+                return hidden;
+            return lastUse<other.lastUse;
+        }
+    };
+    // what the shown gauges drew in this frame interval or the one before,
+    // a pass straddling the boundary or a render thread still finishing,
+    // is kept; a budget too small for them is exceeded rather than rebuilt
+    // every frame
+    quint64 now = qcCacheClock.load();
+    QVector<Candidate> candidates;
+    candidates.reserve(qcCacheEntries.size());
+    for(int i=0;i<qcCacheEntries.size();i++){
+        QcCacheEntry *entry = qcCacheEntries[i];
+        Candidate c;
+        c.entry = entry;
+        c.lastUse = entry->mLastUse.load(std::memory_order_relaxed);
+        QcCacheCounters *owner = entry->mOwner.load(std::memory_order_relaxed);
+        c.hidden = owner && owner->gauge && !owner->gauge->isExposed();
+        if(entry->cacheBytes()>0 && (c.hidden || c.lastUse+1<now))
+            candidates.append(c);
+    }
+    std::sort(candidates.begin(),candidates.end());
+
+    int evicted = 0;
+    for(int i=0;i<candidates.size() && qcCacheUsage.load()>budget;i++){
+        candidates[i].entry->evict();
+        evicted++;
+    }
+    qcCacheEvictions.fetch_add(evicted);
+    return evicted;
+}
+
+// a cached face image or an item snapshot, in paint order
+struct QcRenderLayer
+{
+    QImage face;
+    QcItemSnapshot *snapshot;
+    bool antialiasing;
+};
+
+// builds what the snapshots make lazily, before any of them is drawn
+static void qcPrepareLayers(const QVector<QcRenderLayer> &layers, const QRectF &rect, qreal ratio)
+{
+    QC_TRACE_SCOPE("prepareLayers","paint");
+    for(int i=0;i<layers.size();i++)
+        if(layers[i].snapshot)
+            layers[i].snapshot->prepare(rect,ratio);
+}
+
+static void qcDrawLayers(QPainter *painter, const QVector<QcRenderLayer> &layers, const QRectF &rect)
+{
+    QC_TRACE_SCOPE("drawLayers","paint");
+    for(int i=0;i<layers.size();i++){
+        painter->setRenderHint(QPainter::Antialiasing,layers[i].antialiasing);
+        if(layers[i].snapshot)
+            layers[i].snapshot->draw(painter,rect);
+        else
+            painter->drawImage(QPointF(0,0),layers[i].face);
+    }
+}
+
+static void qcDeleteLayers(QVector<QcRenderLayer> &layers)
+{
+    for(int i=0;i<layers.size();i++)
+        delete layers[i].snapshot;
+    layers.clear();
+}
+
+// renders one frame of a gauge from item snapshots on a pool thread
+class QcRenderJob : public QRunnable
+{
+public:
+    QcRenderJob(QcGaugeWidget *gauge) : nsecs(0), mGauge(gauge)
+    {
+        setAutoDelete(false);
+    }
+
+    ~QcRenderJob()
+    {
+        qcDeleteLayers(layers);
+    }
+
+    void run()
+    {
+        QcCacheCountersScope scope(counters);
+        QElapsedTimer timer;
+        timer.start();
+        image = QImage(size*ratio,QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(ratio);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        QRectF rect = QcItem::squareRect(QRect(QPoint(0,0),size));
+        qcPrepareLayers(layers,rect,ratio);
+        qcDrawLayers(&painter,layers,rect);
+        painter.end();
+        nsecs = timer.nsecsElapsed();
+
+        QMetaObject::invokeMethod(mGauge,"renderFinished",Qt::QueuedConnection);
+        done.release();
+    }
+
+    QVector<QcRenderLayer> layers;
+    QSize size;
+    qreal ratio;
+    QImage image;
+    qint64 nsecs;  // spent rendering, the paint only blits the image
+    QSemaphore done;
+    QcCacheCounters *counters;
+
+private:
+    QcGaugeWidget *mGauge;
+};
+
+// renders the part of a frame inside one tile, clipped to the tile
+class QcTileJob : public QRunnable
+{
+public:
+    QcTileJob(QSemaphore *done) : mDone(done)
+    {
+        setAutoDelete(false);
+    }
+
+
+    void run()
+    {
+        QcCacheCountersScope scope(counters);
+        image = QImage(device.size(),QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(ratio);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.translate(-tile().topLeft());
+        painter.setClipRect(tile());
+        qcDrawLayers(&painter,*layers,rect);
+        painter.end();
+        mDone->release();
+    }
+
+    QRectF tile() const
+    {
+        return QRectF(QPointF(device.topLeft())/ratio,QSizeF(device.size())/ratio);
+    }
+
+    const QVector<QcRenderLayer> *layers;  // shared by the tiles of a frame
+    QRect device;  // tile in device pixels
+    qreal ratio;
+    QRectF rect;
+    QImage image;
+    QcCacheCounters *counters;
+
+private:
+    QSemaphore *mDone;
+};
+
+// the faces of one gauge, evicted on the GUI thread like they are built
+class QcFaceCache : public QcCacheEntry
+{
+public:
+    QcFaceCache(QcGaugeWidget *gauge) :
+        QcCacheEntry(QcRenderStatistics::FaceCache), mGauge(gauge) {}
+
+protected:
+    void evict()
+    {
+        mGauge->evictFaces();
+    }
+
+private:
+    QcGaugeWidget *mGauge;
+};
+
 QcGaugeWidget::QcGaugeWidget(QWidget *parent) :
     QWidget(parent)
 {
     setMinimumSize(250,250);
+    mFacesRatio = 0;
+    mFacesValid = false;
+    mFaceCache = new QcFaceCache(this);
+    mRenderPool = 0;
+    mRenderJob = 0;
+    mFrameDirty = true;
+    mTilePool = 0;
+    mTileSize = 256;
+    mFrameBudget = 0;
+    mPaintTime = 0;
+    mQuality = FullQuality;
+    mOverBudget = 0;
+    mUnderBudget = 0;
+    mFrameTimer = new QTimer(this);
+    mFrameTimer->setSingleShot(true);
+    connect(mFrameTimer,&QTimer::timeout,this,static_cast<void (QWidget::*)()>(&QWidget::update));
+    mExposed = true;
+    mDeferred = false;
+    mWatchedWindow = 0;
+    mPriority = QcUpdateScheduler::Normal;
+    mSchedulePending = false;
+    mScheduleActive = false;
+    mScheduledAt = 0;
+    mBatched = false;
+    mBatchFull = false;
+    mLatencyTracking = false;
+    mFrameFresh = false;
+    mCacheCounters = new QcCacheCounters(this);
+    mUpdatePending = false;
+    qcGauges.append(this);
+}
+
+QcGaugeWidget::~QcGaugeWidget()
+{
+    if(mScheduler)
+        mScheduler->removeGauge(this);
+    if(mBatched)
+        QcValueBatch::sGauges.removeOne(this);
+    if(mRenderJob){
+        mRenderJob->done.acquire();
+        delete mRenderJob;
+    }
+    qcGauges.removeOne(this);
+    delete mFaceCache;
+    QcCacheManager::forget(mCacheCounters);
+    delete mCacheCounters;
 }
 
 QcBackgroundItem *QcGaugeWidget::addBackground(float position)
@@ -116,991 +563,5630 @@ QcAttitudeMeter *QcGaugeWidget::addAttitudeMeter(float position)
     return item;
 }
 
+QcDigitalReadoutItem *QcGaugeWidget::addDigitalReadout(float position)
+{
+    auto item = new QcDigitalReadoutItem(this);
+    item->setPosition(position);
+    mItems.append(item);
+    return item;
+}
+
+QcLiteLayer *QcGaugeWidget::addLiteLayer()
+{
+    auto item = new QcLiteLayer(this);
+    mItems.append(item);
+    return item;
+}
+
 void QcGaugeWidget::addItem(QcItem *item,float position)
 {
     // takes parentship of the item
     item->setParent(this);
+    item->parentWidget = this;
+    item->parentGauge = this;
+    item->setQuality(mQuality);
     item->setPosition(position);
     mItems.append(item);
+    invalidateCache();
 }
 
 int QcGaugeWidget::removeItem(QcItem *item)
 {
+   invalidateCache();
    return mItems.removeAll(item);
 }
 
+void QcGaugeWidget::invalidateCache()
+{
+    // static items are re-rendered on the next paint; a render thread
+    // frame made before the change must not be blitted again
+    mFacesValid = false;
+    requestFrame();
+    mFrameDirty = true;
+}
+
 QList<QcItem *> QcGaugeWidget::items()
 {
     return mItems;
 }
 
 
-void QcGaugeWidget::paintEvent(QPaintEvent */*paintEvt*/)
+void QcGaugeWidget::setRenderThreadPool(QThreadPool *pool)
 {
-    QStyleOption opt;
-    opt.init(this);
-    QPainter painter(this);
-    style()->drawPrimitive(QStyle::PE_Widget, &opt, &painter, this);
-    painter.setRenderHint(QPainter::Antialiasing);
-
-    foreach (QcItem * item, mItems) {
-        item->draw(&painter);
-    }
+    // with a pool, frames are rendered on its threads from item snapshots and
+    // paintEvent() only blits the last finished frame; gauges of a dashboard
+    // can share a single thread pool, which must outlive them
+    mRenderPool = pool;
+    if(!pool)
+        mFrame = QImage();
+    mFrameDirty = true;
+    update();
 }
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
 
-QcItem::QcItem(QObject *parent) :
-    QObject(parent)
+QThreadPool *QcGaugeWidget::renderThreadPool()
 {
-
-    parentWidget = qobject_cast<QWidget*>(parent);
-    mPosition = 50;
+    return mRenderPool;
 }
 
-int QcItem::type()
+void QcGaugeWidget::setTileRendering(QThreadPool *pool, int tileSize)
 {
-    return 50;
+    // large gauges painted on the GUI thread are split into tiles of
+    // tileSize device pixels, rasterized in parallel on the pool
+    mTilePool = pool;
+    mTileSize = qMax(tileSize,16);
+    update();
 }
 
-void QcItem::update()
+bool QcGaugeWidget::isExposed()
 {
-    parentWidget->update();
+    return mExposed;
 }
 
-float QcItem::position()
+bool QcGaugeWidget::checkExposed()
 {
-    return mPosition;
+    // the visible region is looked at on the first change after a paint;
+    // later changes of the same frame just read the flag, unless the paint
+    // is overdue, then the gauge may have been covered or scrolled out
+    if(!mFrameDirty || !mExposureChecked.isValid() || mExposureChecked.hasExpired(ExposureCheckInterval)){
+        mFrameDirty = true;
+        mExposed = isVisible() && !window()->isMinimized() && !visibleRegion().isEmpty();
+        mExposureChecked.start();
+    }
+    return mExposed;
 }
 
-QRectF QcItem::rect()
+void QcGaugeWidget::showEvent(QShowEvent *)
 {
-    return mRect;
+    // a minimized window doesn't send hide events to its children
+    if(mWatchedWindow!=window()){
+        if(mWatchedWindow)
+            mWatchedWindow->removeEventFilter(this);
+        mWatchedWindow = window()!=this ? window() : 0;
+        if(mWatchedWindow)
+            mWatchedWindow->installEventFilter(this);
+    }
+    mExposed = true;
 }
 
-void QcItem::setPosition(float position)
+void QcGaugeWidget::hideEvent(QHideEvent *)
 {
-    if(position>100)
-        mPosition = 100;
-    else if(position<0)
-        mPosition = 0;
-    else
-        mPosition = position;
-    update();
+    mExposed = false;
 }
 
-QRectF QcItem::adjustRect(float percentage)
+bool QcGaugeWidget::eventFilter(QObject *watched, QEvent *event)
 {
-    float r = getRadius(mRect);
-    float offset =   r-(percentage*r)/100.0;
-    QRectF tmpRect = mRect.adjusted(offset,offset,-offset,-offset);
-    return tmpRect;
+    if(watched==mWatchedWindow && event->type()==QEvent::WindowStateChange
+            && mWatchedWindow->isMinimized())
+        mExposed = false;
+    return QWidget::eventFilter(watched,event);
 }
 
-float QcItem::getRadius(const QRectF &tmpRect)
+void QcGaugeWidget::applyDeferred()
 {
-    float r = 0;
-    if(tmpRect.width()<tmpRect.height())
-        r = tmpRect.width()/2.0;
-    else
-        r = tmpRect.height()/2.0;
-    return r;
+    if(!mDeferred)
+        return;
+    mDeferred = false;
+    foreach (QcItem * item, mItems) {
+        item->applyDeferred();
+    }
 }
 
-QRectF QcItem::resetRect()
+void QcGaugeWidget::setUpdateScheduler(QcUpdateScheduler *scheduler, QcUpdateScheduler::Priority priority)
 {
-    mRect = parentWidget->rect();
-    float r = getRadius(mRect);
-    mRect.setWidth(2.0*r);
-    mRect.setHeight(2.0*r);
-    mRect.moveCenter(parentWidget->rect().center());
-    return mRect;
+    if(mScheduler)
+        mScheduler->removeGauge(this);
+    mScheduler = scheduler;
+    mPriority = priority;
+    if(mScheduler){
+        mScheduler->addGauge(this);
+        if(mSchedulePending)
+            mScheduler->request();
+    }
+    else if(mSchedulePending){
+        mSchedulePending = false;
+        update();
+    }
 }
 
-QPointF QcItem::getPoint(float deg,const QRectF &tmpRect)
+QcUpdateScheduler *QcGaugeWidget::updateScheduler()
 {
-    float r = getRadius(tmpRect);
-    float xx=cos(qDegreesToRadians(deg))*r;
-    float yy=sin(qDegreesToRadians(deg))*r;
-    QPointF pt;
-    xx=tmpRect.center().x()-xx;
-    yy=tmpRect.center().y()-yy;
-    pt.setX(xx);
-    pt.setY(yy);
-    return pt;
+    return mScheduler;
 }
 
+QcUpdateScheduler::Priority QcGaugeWidget::refreshPriority()
+{
+    return mPriority;
+}
 
-
-float QcItem::getAngle(const QPointF&pt, const QRectF &tmpRect)
+void QcGaugeWidget::setLatencyTracking(bool enabled)
 {
-    float xx=tmpRect.center().x()-pt.x();
-    float yy=tmpRect.center().y()-pt.y();
-    return qRadiansToDegrees( atan2(yy,xx));
+    mLatencyTracking = enabled;
+    if(!enabled)
+        resetLatency();
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
+bool QcGaugeWidget::latencyTracking()
+{
+    return mLatencyTracking;
+}
 
-QcScaleItem::QcScaleItem(QObject *parent) :
-    QcItem(parent)
+QcLatencyHistogram QcGaugeWidget::latency()
 {
-    mMinDegree = -45;
-    mMaxDegree = 225;
-    mMinValue = 0;
-    mMaxValue = 100;
-    mDegreeOffset = 0;
+    return mLatency;
 }
 
-void QcScaleItem::setValueRange(float minValue, float maxValue)
+QcLatencyHistogram QcGaugeWidget::channelLatency(QcItem *item, int handle)
 {
-    if (minValue < maxValue) {
-        mMinValue = minValue;
-        mMaxValue = maxValue;
+    for(int i=0;i<mLatencyChannels.size();i++)
+        if(mLatencyChannels[i].item==item && mLatencyChannels[i].handle==handle)
+            return mLatencyChannels[i].histogram;
+    return QcLatencyHistogram();
+}
 
-    } else throw (InvalidValueRange);
+void QcGaugeWidget::resetLatency()
+{
+    mLatency.clear();
+    mLatencyChannels.clear();
+    mLatencyPending.clear();
+    mLatencyRendering.clear();
 }
 
-void QcScaleItem::setDegreeRange(float minDegree, float maxDegree)
+QcRenderStatistics QcGaugeWidget::renderStatistics()
 {
-    if (minDegree < maxDegree) {
-        mMinDegree = minDegree;
-        mMaxDegree = maxDegree;
-    } else throw (InvalidValueRange);
+    QcRenderStatistics s = mStatistics;
+    mCacheCounters->copyTo(s);
+    s.cacheBytes = cacheBytes();
+    qcPaintTimes(s,mPaintTimes);
+    return s;
 }
 
-float QcScaleItem::getDegFromValue(float v) const
+void QcGaugeWidget::resetRenderStatistics()
 {
-    float a = (mMaxDegree-mMinDegree)/(mMaxValue-mMinValue);
-    float b = -a*mMinValue+mMinDegree;
-    return mDegreeOffset+(a*v+b);
+    mStatistics = QcRenderStatistics();
+    mCacheCounters->clear();
+    mPaintTimes.clear();
 }
 
-float QcScaleItem::getDegFromValue()
+QcRenderStatistics QcGaugeWidget::globalRenderStatistics()
 {
-    return getDegFromValue(mMinValue);
+    QcRenderStatistics s = qcGlobalStatistics;
+    qcGlobalCache.copyTo(s);
+    s.cacheBytes = QcGlyphAtlas::cachedBytes();
+    for(int i=0;i<qcGauges.size();i++)
+        s.cacheBytes += qcGauges[i]->cacheBytes();
+    qcPaintTimes(s,qcGlobalPaintTimes);
+    return s;
 }
 
+void QcGaugeWidget::resetGlobalRenderStatistics()
+{
+    qcGlobalStatistics = QcRenderStatistics();
+    qcGlobalCache.clear();
+    qcGlobalPaintTimes.clear();
+}
 
-void QcScaleItem::setMinValue(float minValue)
+void QcGaugeWidget::countUpdate()
 {
-    if(minValue>mMaxValue)
-        throw (InvalidValueRange);
-    mMinValue = minValue;
-    update();
+    // an item change asking for a repaint; one made before the paint
+    // serving an earlier one is merged into it, in a batch, the scheduler
+    // or by Qt
+    mStatistics.updatesRequested++;
+    qcGlobalStatistics.updatesRequested++;
+    if(mUpdatePending){
+        mStatistics.updatesCoalesced++;
+        qcGlobalStatistics.updatesCoalesced++;
+    }
+    mUpdatePending = true;
 }
 
+void QcGaugeWidget::countDroppedValue()
+{
+    mStatistics.valuesDropped++;
+    qcGlobalStatistics.valuesDropped++;
+}
 
-void QcScaleItem::setMaxValue(float maxValue)
+qint64 QcGaugeWidget::cacheBytes()
 {
-    if(maxValue<mMinValue )
-        throw (InvalidValueRange);
-    mMaxValue = maxValue;
-    update();
+    qint64 bytes = qcImageBytes(mFrame)+mFaceCache->cacheBytes();
+    for(int i=0;i<mItems.size();i++)
+        bytes += mItems[i]->cacheBytes();
+    return bytes;
 }
 
-void QcScaleItem::setMinDegree(float minDegree)
+void QcGaugeWidget::recordSample(QcItem *item, int handle, qint64 stamp)
 {
-    if(minDegree>mMaxDegree)
-        throw (InvalidDegreeRange);
-    mMinDegree = minDegree;
-    update();
+    // a hidden gauge would count the time it wasn't shown
+    if(!mExposed)
+        return;
+    int i = 0;
+    while(i<mLatencyChannels.size() && (mLatencyChannels[i].item!=item || mLatencyChannels[i].handle!=handle))
+        i++;
+    if(i==mLatencyChannels.size()){
+        LatencyChannel channel;
+        channel.item = item;
+        channel.handle = handle;
+        channel.pending = 0;
+        channel.rendering = 0;
+        mLatencyChannels.append(channel);
+    }
+    // only the newest of coalesced samples reaches the screen
+    LatencyChannel &channel = mLatencyChannels[i];
+    if(!channel.pending)
+        mLatencyPending.append(i);
+    channel.pending = stamp;
 }
 
-void QcScaleItem::setMaxDegree(float maxDegree)
+void QcGaugeWidget::recordLatency(QVector<int> &channels, bool rendered)
 {
-    if(maxDegree<mMinDegree)
-        throw (InvalidDegreeRange);
-    mMaxDegree = maxDegree;
+    qint64 now = QcValueBus::timestamp();
+    for(int i=0;i<channels.size();i++){
+        LatencyChannel &channel = mLatencyChannels[channels[i]];
+        qint64 &stamp = rendered ? channel.rendering : channel.pending;
+        if(!stamp)
+            continue;
+        channel.histogram.add(now-stamp);
+        mLatency.add(now-stamp);
+        stamp = 0;
+    }
+    channels.resize(0);
+}
+
+void QcGaugeWidget::requestFrame()
+{
+    QC_TRACE_INSTANT("requestFrame","schedule");
+    if(QcValueBatch::sDepth>0){
+        QcValueBatch::add(this);
+        mBatchFull = true;
+        return;
+    }
+    // Qt paints the gauge anyway once it is shown, restored or scrolled
+    // back into view, so a hidden gauge just stays dirty
+    if(!checkExposed())
+        return;
+    if(mQuality>=ReducedFrameRate && mLastFrame.isValid() && mLastFrame.elapsed()<ReducedFrameInterval){
+        if(!mFrameTimer->isActive())
+            mFrameTimer->start(ReducedFrameInterval-mLastFrame.elapsed());
+        return;
+    }
+    if(mScheduler){
+        mScheduleActive = true;
+        if(!mSchedulePending){
+            mSchedulePending = true;
+            mScheduler->request();
+        }
+        return;
+    }
     update();
 }
 
-void QcScaleItem::setDegreeOffset(float degreeOffset)
+void QcGaugeWidget::requestFrame(const QRect &rect)
 {
-    mDegreeOffset = degreeOffset;
+    if(QcValueBatch::sDepth>0){
+        QcValueBatch::add(this);
+        mBatchRect |= rect;
+        return;
+    }
+    if(mRenderPool || mQuality>=ReducedFrameRate || mScheduler){
+        requestFrame();
+        return;
+    }
+    if(checkExposed())
+        update(rect);
+}
+
+void QcGaugeWidget::setFrameBudget(float msecs)
+{
+    // 0 turns the controller off and restores full quality
+    mFrameBudget = msecs;
+    mPaintTime = 0;
+    mOverBudget = 0;
+    mUnderBudget = 0;
+    if(msecs<=0)
+        setQuality(FullQuality);
+}
+
+float QcGaugeWidget::frameBudget()
+{
+    return mFrameBudget;
+}
+
+QcGaugeWidget::Quality QcGaugeWidget::quality()
+{
+    return mQuality;
+}
+
+float QcGaugeWidget::paintTime()
+{
+    return mPaintTime;
+}
+
+void QcGaugeWidget::adaptQuality(float msecs)
+{
+    if(mPaintTime>mFrameBudget){
+        mUnderBudget = 0;
+        if(++mOverBudget>=QualityFrames && mQuality<ReducedFrameRate){
+            mOverBudget = 0;
+            setQuality(Quality(mQuality+1));
+        }
+    }
+    else if(mPaintTime<mFrameBudget/2){
+        // step back up slower than down, so the level doesn't oscillate
+        mOverBudget = 0;
+        if(++mUnderBudget>=4*QualityFrames && mQuality>FullQuality){
+            mUnderBudget = 0;
+            setQuality(Quality(mQuality-1));
+        }
+    }
+    else{
+        mOverBudget = 0;
+        mUnderBudget = 0;
+    }
+}
+
+void QcGaugeWidget::setQuality(QcGaugeWidget::Quality quality)
+{
+    if(quality==mQuality)
+        return;
+    if((quality>=FlatFills)!=(mQuality>=FlatFills))
+        mFacesValid = false;
+    mQuality = quality;
+    foreach (QcItem * item, mItems) {
+        item->setQuality(quality);
+    }
+    emit qualityChanged(quality);
+    requestFrame();
+}
+
+void QcGaugeWidget::paintEvent(QPaintEvent */*paintEvt*/)
+{
+    QC_TRACE_SCOPE("paintEvent","paint");
+    QcCacheCountersScope counters(mCacheCounters);
+    QStyleOption opt;
+    opt.init(this);
+    QPainter painter(this);
+    style()->drawPrimitive(QStyle::PE_Widget, &opt, &painter, this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    QElapsedTimer timer;
+    timer.start();
+    mLastFrame.start();
+    qcCacheFrame();
+    mExposed = true;
+    mSchedulePending = false;
+    mUpdatePending = false;
+    applyDeferred();
+
+    bool blit = false;
+    if(mRenderPool){
+        // the frame finished on the render thread reaches the screen now
+        if(mFrameFresh){
+            mFrameFresh = false;
+            recordLatency(mLatencyRendering,true);
+        }
+        bool resized = mFrame.size()!=size()*devicePixelRatioF();
+        if(mRenderJob || !(mFrameDirty || resized) || startRender()){
+            if(!resized)
+                painter.drawImage(QPointF(0,0),mFrame);
+            else if(!mFrame.isNull())
+                painter.drawImage(QRectF(rect()),mFrame);
+            blit = true;
+        }
+    }
+
+    if(!blit){
+        waitForRender();
+        if(!mTilePool || !paintTiles(&painter))
+            paintItems(&painter);
+        mFrameDirty = false;
+        if(!mLatencyPending.isEmpty())
+            recordLatency(mLatencyPending,false);
+    }
+
+    mStatistics.framesPainted++;
+    qcGlobalStatistics.framesPainted++;
+    // a blit of a frame from the render thread is timed there instead
+    if(!blit)
+        recordPaintTime(timer.nsecsElapsed());
+    QcCacheManager::trimIfNeeded();
+}
+
+void QcGaugeWidget::recordPaintTime(qint64 nsecs)
+{
+    // smoothed paint time, also the cost estimate of the update scheduler
+    float msecs = nsecs/1000000.0;
+    mPaintTime = mPaintTime>0 ? 0.8*mPaintTime+0.2*msecs : msecs;
+    mStatistics.lastPaintTime = msecs;
+    mPaintTimes.add(nsecs);
+    qcGlobalStatistics.lastPaintTime = msecs;
+    qcGlobalPaintTimes.add(nsecs);
+    if(mFrameBudget>0)
+        adaptQuality(msecs);
+}
+
+void QcGaugeWidget::paintItems(QPainter *painter)
+{
+    ensureFaces();
+
+    int face = 0;
+    for(int i=0;i<mItems.size();){
+        if(face<mFaces.size() && mFaces[face].first==i){
+            painter->drawImage(QPointF(0,0),mFaces[face].image);
+            i+=mFaces[face].count;
+            face++;
+        }
+        else{
+            QC_TRACE_SCOPE(mItems[i]->metaObject()->className(),"draw");
+            painter->setRenderHint(QPainter::Antialiasing,mQuality<NoDynamicAntialiasing);
+            mItems[i]->draw(painter);
+            i++;
+        }
+    }
+}
+
+bool QcGaugeWidget::snapshotLayers(QVector<QcRenderLayer> &layers)
+{
+    if(mSnapshotBlocker && mItems.contains(mSnapshotBlocker.data()))
+        return false;
+    ensureFaces();
+
+    int face = 0;
+    for(int i=0;i<mItems.size();){
+        QcRenderLayer layer;
+        layer.snapshot = 0;
+        layer.antialiasing = mQuality<NoDynamicAntialiasing;
+        if(face<mFaces.size() && mFaces[face].first==i){
+            layer.face = mFaces[face].image;
+            i+=mFaces[face].count;
+            face++;
+        }
+        else{
+            layer.snapshot = mItems[i]->snapshot();
+            if(!layer.snapshot){
+                mSnapshotBlocker = mItems[i];
+                qcDeleteLayers(layers);
+                return false;
+            }
+            i++;
+        }
+        layers.append(layer);
+    }
+    return true;
+}
+
+bool QcGaugeWidget::startRender()
+{
+    QcRenderJob *job = new QcRenderJob(this);
+    job->counters = mCacheCounters;
+    job->size = size();
+    job->ratio = devicePixelRatioF();
+    if(!snapshotLayers(job->layers)){
+        delete job;
+        return false;
+    }
+
+    mRenderJob = job;
+    mFrameDirty = false;
+    // the samples snapshotted for the job
+    for(int i=0;i<mLatencyPending.size();i++){
+        LatencyChannel &channel = mLatencyChannels[mLatencyPending[i]];
+        channel.rendering = channel.pending;
+        channel.pending = 0;
+    }
+    mLatencyRendering.swap(mLatencyPending);
+    mLatencyPending.resize(0);
+    mRenderPool->start(job);
+    return true;
+}
+
+bool QcGaugeWidget::paintTiles(QPainter *painter)
+{
+    qreal ratio = devicePixelRatioF();
+    QSize device = size()*ratio;
+    int columns = (device.width()+mTileSize-1)/mTileSize;
+    int rows = (device.height()+mTileSize-1)/mTileSize;
+    if(columns*rows<2)
+        return false;
+
+    // the items are snapshotted once, all tiles draw the same snapshots
+    QVector<QcRenderLayer> layers;
+    if(!snapshotLayers(layers))
+        return false;
+    QSemaphore done;
+    QVector<QcTileJob*> jobs;
+    QRectF rect = QcItem::squareRect(this->rect());
+    for(int y=0;y<rows;y++){
+        for(int x=0;x<columns;x++){
+            QcTileJob *job = new QcTileJob(&done);
+            job->device = QRect(x*mTileSize,y*mTileSize,mTileSize,mTileSize)
+                    .intersected(QRect(QPoint(0,0),device));
+            job->ratio = ratio;
+            job->rect = rect;
+            job->counters = mCacheCounters;
+            job->layers = &layers;
+            jobs.append(job);
+        }
+    }
+    // tick lines, needle outlines and text layouts are built up front, the
+    // tiles only read the snapshots; the first tile runs on this thread
+    qcPrepareLayers(layers,rect,ratio);
+    for(int i=1;i<jobs.size();i++)
+        mTilePool->start(jobs[i]);
+    jobs[0]->run();
+    done.acquire(jobs.size());
+
+    for(int i=0;i<jobs.size();i++)
+        painter->drawImage(jobs[i]->tile().topLeft(),jobs[i]->image);
+    qDeleteAll(jobs);
+    qcDeleteLayers(layers);
+    return true;
+}
+
+void QcGaugeWidget::renderFinished()
+{
+    if(!mRenderJob)
+        return;
+    mRenderJob->done.acquire();
+    if(mRenderPool){
+        mFrame = mRenderJob->image;
+        mFrameFresh = true;
+    }
+    recordPaintTime(mRenderJob->nsecs);
+    // snapshots are deleted on the GUI thread
+    delete mRenderJob;
+    mRenderJob = 0;
+    QcCacheManager::trimIfNeeded();
     update();
 }
-
+
+void QcGaugeWidget::waitForRender()
+{
+    // item caches are shared with the snapshots being rendered
+    if(mRenderJob){
+        mRenderJob->done.acquire();
+        mRenderJob->done.release();
+    }
+}
+
+void QcGaugeWidget::ensureFaces()
+{
+    mFaceCache->touch();
+    if(mFacesValid && mFacesSize==size() && mFacesRatio==devicePixelRatioF()){
+        qcCountCache(QcRenderStatistics::FaceCache,QcCacheHit);
+        return;
+    }
+    qcCountCache(QcRenderStatistics::FaceCache,mFacesRatio>0 ? QcCacheRebuild : QcCacheMiss);
+    updateFaces();
+}
+
+void QcGaugeWidget::updateFaces()
+{
+    QC_TRACE_SCOPE("updateFaces","cache");
+    mFaces.clear();
+    mFacesSize = size();
+    mFacesRatio = devicePixelRatioF();
+    mFacesValid = true;
+
+    int i=0;
+    while(i<mItems.size()){
+        if(!mItems[i]->isStatic()){
+            i++;
+            continue;
+        }
+        Face face;
+        face.first = i;
+        face.count = 0;
+        face.image = QImage(mFacesSize*mFacesRatio,QImage::Format_ARGB32_Premultiplied);
+        face.image.setDevicePixelRatio(mFacesRatio);
+        face.image.fill(Qt::transparent);
+
+        QPainter painter(&face.image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        while(i<mItems.size() && mItems[i]->isStatic()){
+            mItems[i]->draw(&painter);
+            face.count++;
+            i++;
+        }
+        mFaces.append(face);
+    }
+
+    qint64 bytes = 0;
+    for(int i=0;i<mFaces.size();i++)
+        bytes += qcImageBytes(mFaces[i].image);
+    mFaceCache->setCacheBytes(bytes);
+}
+
+void QcGaugeWidget::evictFaces()
+{
+    // render jobs in flight keep their own references to the images
+    mFaces.clear();
+    mFacesValid = false;
+    mFaceCache->setCacheBytes(0);
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef QCGAUGE_TRACE
+struct QcTraceEvent
+{
+    const char *name;
+    const char *category;
+    qint64 begin;
+    qint64 duration;  // -1 for an instant event
+    int thread;
+};
+
+// written by every thread without a lock, an event costs a slot claim and four stores
+static QcTraceEvent qcTraceRing[QcTrace::Capacity];
+static std::atomic<quint64> qcTraceNext(0);
+static std::atomic<bool> qcTraceEnabled(true);
+static std::atomic<int> qcTraceThreads(0);
+
+static inline int qcTraceThread()
+{
+    static thread_local int thread = ++qcTraceThreads;
+    return thread;
+}
+
+static inline void qcTraceRecord(const char *name, const char *category, qint64 begin, qint64 duration)
+{
+    if(!qcTraceEnabled.load(std::memory_order_relaxed))
+        return;
+    quint64 n = qcTraceNext.fetch_add(1,std::memory_order_relaxed);
+    QcTraceEvent &e = qcTraceRing[n&(QcTrace::Capacity-1)];
+    e.name = name;
+    e.category = category;
+    e.begin = begin;
+    e.duration = duration;
+    e.thread = qcTraceThread();
+}
+#endif
+
+void QcTrace::setEnabled(bool enabled)
+{
+#ifdef QCGAUGE_TRACE
+    qcTraceEnabled.store(enabled);
+#else
+    Q_UNUSED(enabled);
+#endif
+}
+
+bool QcTrace::isEnabled()
+{
+#ifdef QCGAUGE_TRACE
+    return qcTraceEnabled.load();
+#else
+    return false;
+#endif
+}
+
+void QcTrace::clear()
+{
+#ifdef QCGAUGE_TRACE
+    qcTraceNext.store(0);
+    memset(qcTraceRing,0,sizeof(qcTraceRing));
+#endif
+}
+
+void QcTrace::complete(const char *name, const char *category, qint64 begin)
+{
+#ifdef QCGAUGE_TRACE
+    qcTraceRecord(name,category,begin,now()-begin);
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(category);
+    Q_UNUSED(begin);
+#endif
+}
+
+void QcTrace::instant(const char *name, const char *category)
+{
+#ifdef QCGAUGE_TRACE
+    qcTraceRecord(name,category,now(),-1);
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(category);
+#endif
+}
+
+qint64 QcTrace::now()
+{
+    return QcValueBus::timestamp();
+}
+
+bool QcTrace::write(QIODevice *device)
+{
+    // events still being written while this runs may come out torn,
+    // dump when the gauges are quiet
+    if(device->write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n")<0)
+        return false;
+#ifdef QCGAUGE_TRACE
+    qint64 pid = QCoreApplication::applicationPid();
+    quint64 end = qcTraceNext.load();
+    quint64 begin = end>quint64(Capacity) ? end-Capacity : 0;
+    bool first = true;
+    char line[512];
+    for(quint64 n=begin;n<end;n++){
+        const QcTraceEvent &e = qcTraceRing[n&(Capacity-1)];
+        if(!e.name)
+            continue;
+        int length;
+        if(e.duration<0)
+            length = snprintf(line,sizeof(line),
+                              "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%lld,\"tid\":%d}",
+                              first ? "" : ",\n",e.name,e.category,e.begin/1000.0,(long long)pid,e.thread);
+        else
+            length = snprintf(line,sizeof(line),
+                              "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lld,\"tid\":%d}",
+                              first ? "" : ",\n",e.name,e.category,e.begin/1000.0,e.duration/1000.0,(long long)pid,e.thread);
+        if(device->write(line,qMin(length,int(sizeof(line))-1))<0)
+            return false;
+        first = false;
+    }
+#endif
+    return device->write("\n]}\n")>=0;
+}
+
+bool QcTrace::write(const QString &fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    return write(&file);
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcLatencyHistogram::QcLatencyHistogram()
+{
+    clear();
+}
+
+void QcLatencyHistogram::add(qint64 nsecs)
+{
+    qint64 usecs = qMax(nsecs,qint64(0))/1000;
+    int i = 0;
+    while(i<Buckets-1 && usecs>=bucketLimit(i))
+        i++;
+    mBuckets[i]++;
+    mCount++;
+    mSum += nsecs;
+    mMax = qMax(mMax,nsecs);
+}
+
+void QcLatencyHistogram::merge(const QcLatencyHistogram &other)
+{
+    for(int i=0;i<Buckets;i++)
+        mBuckets[i] += other.mBuckets[i];
+    mCount += other.mCount;
+    mSum += other.mSum;
+    mMax = qMax(mMax,other.mMax);
+}
+
+void QcLatencyHistogram::clear()
+{
+    memset(mBuckets,0,sizeof(mBuckets));
+    mCount = 0;
+    mSum = 0;
+    mMax = 0;
+}
+
+quint64 QcLatencyHistogram::count() const
+{
+    return mCount;
+}
+
+double QcLatencyHistogram::mean() const
+{
+    return mCount ? mSum/1000.0/mCount : 0;
+}
+
+qint64 QcLatencyHistogram::max() const
+{
+    return mMax/1000;
+}
+
+qint64 QcLatencyHistogram::percentile(double p) const
+{
+    // upper limit of the bucket holding the percentile, capped by the maximum
+    quint64 rank = quint64(qBound(0.0,p,1.0)*mCount);
+    quint64 seen = 0;
+    for(int i=0;i<Buckets;i++){
+        seen += mBuckets[i];
+        if(seen>0 && seen>=rank)
+            return qMin(bucketLimit(i),max());
+    }
+    return max();
+}
+
+quint64 QcLatencyHistogram::bucket(int i) const
+{
+    return mBuckets[i];
+}
+
+qint64 QcLatencyHistogram::bucketLimit(int i)
+{
+    return qint64(1)<<i;
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcRenderStatistics::QcRenderStatistics()
+{
+    framesPainted = 0;
+    updatesRequested = 0;
+    updatesCoalesced = 0;
+    valuesDropped = 0;
+    for(int i=0;i<CacheCount;i++){
+        cacheHits[i] = 0;
+        cacheMisses[i] = 0;
+        cacheRebuilds[i] = 0;
+    }
+    cacheBytes = 0;
+    lastPaintTime = 0;
+    averagePaintTime = 0;
+    p99PaintTime = 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+qint64 QcValueBatch::sStamp = 0;
+int QcValueBatch::sDepth = 0;
+QVector<QcGaugeWidget*> QcValueBatch::sGauges;
+
+void QcValueBatch::begin()
+{
+    sDepth++;
+}
+
+void QcValueBatch::commit()
+{
+    if(sDepth<=0 || --sDepth>0)
+        return;
+    QC_TRACE_SCOPE("commitBatch","schedule");
+    // swapped out first, a repaint request can't land in the list being walked
+    QVector<QcGaugeWidget*> gauges;
+    gauges.swap(sGauges);
+    for(int i=0;i<gauges.size();i++){
+        QcGaugeWidget *gauge = gauges[i];
+        gauge->mBatched = false;
+        if(gauge->mBatchFull)
+            gauge->requestFrame();
+        else if(!gauge->mBatchRect.isNull())
+            gauge->requestFrame(gauge->mBatchRect);
+        gauge->mBatchFull = false;
+        gauge->mBatchRect = QRect();
+    }
+    // keeps the capacity for the next batch
+    gauges.clear();
+    if(sGauges.isEmpty())
+        sGauges.swap(gauges);
+}
+
+bool QcValueBatch::isActive()
+{
+    return sDepth>0;
+}
+
+void QcValueBatch::apply(const QcChannelValue *values, int count)
+{
+    QC_TRACE_SCOPE("applyValues","ingest");
+    begin();
+    for(int i=0;i<count;i++){
+        const QcChannelValue &v = values[i];
+        sStamp = v.stamp;
+        v.item->setChannelValue(v.handle,v.value);
+        QcGaugeWidget *gauge = v.item->parentGauge;
+        // a dropped value asks for no paint, its stamp would wait for an
+        // unrelated one and be counted as latency
+        if(v.stamp && gauge && gauge->mLatencyTracking && gauge->mUpdatePending)
+            gauge->recordSample(v.item,v.handle,v.stamp);
+    }
+    sStamp = 0;
+    commit();
+}
+
+qint64 QcValueBatch::stamp()
+{
+    return sStamp;
+}
+
+void QcValueBatch::add(QcGaugeWidget *gauge)
+{
+    if(gauge->mBatched)
+        return;
+    gauge->mBatched = true;
+    sGauges.append(gauge);
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Shared layout of a QcValueBus. The atomics must be lock-free, or they
+// would carry a process local lock.
+static_assert(ATOMIC_INT_LOCK_FREE==2 && ATOMIC_LLONG_LOCK_FREE==2,
+              "QcValueBus needs lock-free 32 and 64 bit atomics");
+
+static const quint32 QcBusMagic = 0x51634256;  // "QcBV"
+static const int QcBusAttachTries = 100;       // 1 ms apart
+static const qint64 QcBusWriterTimeout = 10000000;  // nanoseconds a slot may stay odd
+
+struct alignas(64) QcBusHeader
+{
+    quint32 magic;
+    quint32 capacity;
+    std::atomic<quint32> count;
+};
+
+// one cache line per slot, so writers of neighbouring slots don't contend
+struct alignas(64) QcBusSlot
+{
+    char name[QcValueBus::NameLength];
+    std::atomic<quint32> sequence;
+    std::atomic<quint32> value;  // float bits
+    std::atomic<qint64> stamp;
+};
+
+static inline QcBusHeader* qcBusHeader(QSharedMemory *memory)
+{
+    return static_cast<QcBusHeader*>(memory->data());
+}
+
+static inline QcBusSlot* qcBusSlots(QSharedMemory *memory)
+{
+    return reinterpret_cast<QcBusSlot*>(qcBusHeader(memory)+1);
+}
+
+QcValueBus::QcValueBus(const QString &key, QObject *parent) :
+    QObject(parent)
+{
+    mMemory = new QSharedMemory(key,this);
+    mResolvedCount = 0;
+    mCapacity = 0;
+    mPollTimer = new QTimer(this);
+    connect(mPollTimer,&QTimer::timeout,this,&QcValueBus::poll);
+}
+
+QcValueBus::~QcValueBus()
+{
+    detach();
+}
+
+bool QcValueBus::create(int capacity)
+{
+    detach();
+    if(capacity<1){
+        mError = QStringLiteral("invalid slot count");
+        return false;
+    }
+    qint64 size = qint64(sizeof(QcBusHeader))+qint64(capacity)*qint64(sizeof(QcBusSlot));
+    if(size>INT_MAX){
+        mError = QStringLiteral("too many slots");
+        return false;
+    }
+    if(!mMemory->create(int(size))){
+        mError = mMemory->errorString();
+        return false;
+    }
+    mMemory->lock();
+    QcBusHeader *header = new (mMemory->data()) QcBusHeader;
+    header->capacity = capacity;
+    header->count.store(0);
+    QcBusSlot *s = qcBusSlots(mMemory);
+    for(int i=0;i<capacity;i++){
+        new (s+i) QcBusSlot;
+        memset(s[i].name,0,NameLength);
+        s[i].sequence.store(0);
+        s[i].value.store(0);
+        s[i].stamp.store(0);
+    }
+    header->magic = QcBusMagic;
+    mMemory->unlock();
+    mCapacity = capacity;
+    return true;
+}
+
+bool QcValueBus::attach()
+{
+    detach();
+    if(!mMemory->attach()){
+        mError = mMemory->errorString();
+        return false;
+    }
+    // create() can only take the lock once the segment exists, so a bus
+    // found with a zero magic, as fresh segments are, is still being set up
+    const QcBusHeader *header = qcBusHeader(mMemory);
+    bool valid = false;
+    bool pending = mMemory->size()>=int(sizeof(QcBusHeader));
+    for(int tries=0;pending && tries<QcBusAttachTries;tries++){
+        if(tries>0)
+            QThread::msleep(1);
+        mMemory->lock();
+        quint32 magic = header->magic;
+        valid = magic==QcBusMagic
+                && mMemory->size()>=qint64(sizeof(QcBusHeader))+qint64(header->capacity)*qint64(sizeof(QcBusSlot));
+        pending = magic==0;
+        if(valid)
+            mCapacity = header->capacity;
+        mMemory->unlock();
+        if(valid)
+            break;
+    }
+    if(!valid){
+        mError = QStringLiteral("not a value bus");
+        mMemory->detach();
+    }
+    return valid;
+}
+
+void QcValueBus::detach()
+{
+    if(mMemory->isAttached())
+        mMemory->detach();
+    mResolvedCount = 0;
+    mCapacity = 0;
+    for(int i=0;i<mBindings.size();i++)
+        mBindings[i].slot = -1;
+}
+
+bool QcValueBus::isAttached()
+{
+    return mMemory->isAttached();
+}
+
+QString QcValueBus::errorString()
+{
+    return mError;
+}
+
+int QcValueBus::slotCount()
+{
+    return isAttached() ? int(qcBusHeader(mMemory)->count.load(std::memory_order_acquire)) : 0;
+}
+
+int QcValueBus::addSlot(const char *name)
+{
+    if(!isAttached())
+        return -1;
+    // registration is rare, the system lock of the segment is good enough
+    mMemory->lock();
+    int i = slot(name);
+    if(i<0){
+        QcBusHeader *header = qcBusHeader(mMemory);
+        quint32 count = header->count.load(std::memory_order_relaxed);
+        if(count<header->capacity){
+            QcBusSlot &s = qcBusSlots(mMemory)[count];
+            strncpy(s.name,name,NameLength-1);
+            // publishes the name together with the new count
+            header->count.store(count+1,std::memory_order_release);
+            i = count;
+        }
+        else
+            mError = QStringLiteral("value bus is full");
+    }
+    mMemory->unlock();
+    return i;
+}
+
+void QcValueBus::write(int slot, float value)
+{
+    write(slot,value,timestamp());
+}
+
+void QcValueBus::write(int slot, float value, qint64 stamp)
+{
+    // slot -1 would land in the header every process reads
+    if(slot<0 || slot>=mCapacity)
+        return;
+    QcBusSlot &s = qcBusSlots(mMemory)[slot];
+    // taking the odd sequence also serializes writers of the same slot. A
+    // producer that died between taking and releasing it leaves it odd for
+    // good, so one odd for longer than QcBusWriterTimeout is taken over by
+    // moving it on while keeping it odd; a writer that was only stalled
+    // that long may then publish a value with the other one's stamp
+    quint32 seq = s.sequence.load(std::memory_order_relaxed);
+    qint64 waiting = 0;
+    for(;;){
+        if(!(seq&1)){
+            if(s.sequence.compare_exchange_weak(seq,seq+1,std::memory_order_acquire,std::memory_order_relaxed)){
+                seq++;
+                break;
+            }
+            waiting = 0;
+            continue;
+        }
+        if(!waiting)
+            waiting = timestamp();
+        else if(timestamp()-waiting>QcBusWriterTimeout){
+            if(s.sequence.compare_exchange_strong(seq,seq+2,std::memory_order_acquire,std::memory_order_relaxed)){
+                seq += 2;
+                break;
+            }
+            waiting = 0;
+            continue;
+        }
+        quint32 current = s.sequence.load(std::memory_order_relaxed);
+        if(current!=seq)
+            waiting = 0;
+        seq = current;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    quint32 bits;
+    memcpy(&bits,&value,sizeof(bits));
+    s.value.store(bits,std::memory_order_relaxed);
+    s.stamp.store(stamp,std::memory_order_relaxed);
+    s.sequence.store(seq+1,std::memory_order_release);
+}
+
+int QcValueBus::slot(const char *name)
+{
+    if(!isAttached())
+        return -1;
+    const QcBusSlot *s = qcBusSlots(mMemory);
+    int count = slotCount();
+    for(int i=0;i<count;i++)
+        if(strncmp(s[i].name,name,NameLength-1)==0)
+            return i;
+    return -1;
+}
+
+bool QcValueBus::read(int slot, float *value, qint64 *stamp)
+{
+    if(slot<0 || slot>=mCapacity)
+        return false;
+    QcBusSlot &s = qcBusSlots(mMemory)[slot];
+    quint32 bits;
+    qint64 t;
+    // a writer is a few stores long, the retries are bounded in practice
+    for(int tries=0;tries<1000;tries++){
+        quint32 seq = s.sequence.load(std::memory_order_acquire);
+        if(seq&1)
+            continue;
+        bits = s.value.load(std::memory_order_relaxed);
+        t = s.stamp.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(s.sequence.load(std::memory_order_relaxed)!=seq)
+            continue;
+        memcpy(value,&bits,sizeof(bits));
+        if(stamp)
+            *stamp = t;
+        return true;
+    }
+    return false;
+}
+
+quint32 QcValueBus::version(int slot)
+{
+    if(slot<0 || slot>=mCapacity)
+        return 0;
+    return qcBusSlots(mMemory)[slot].sequence.load(std::memory_order_acquire);
+}
+
+void QcValueBus::bind(const char *name, QcItem *item, int handle)
+{
+    Binding b;
+    memset(b.name,0,NameLength);
+    strncpy(b.name,name,NameLength-1);
+    b.slot = slot(name);
+    b.item = item;
+    b.handle = handle;
+    b.version = 0;
+    mBindings.append(b);
+}
+
+void QcValueBus::unbind(QcItem *item)
+{
+    for(int i=mBindings.size()-1;i>=0;i--)
+        if(mBindings[i].item==item)
+            mBindings.remove(i);
+}
+
+void QcValueBus::setPollInterval(int msecs)
+{
+    // 0 stops polling, poll() can then be called at frame time instead
+    if(msecs>0)
+        mPollTimer->start(msecs);
+    else
+        mPollTimer->stop();
+}
+
+qint64 QcValueBus::timestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void QcValueBus::resolve()
+{
+    // slots registered since the last poll may match pending bindings
+    for(int i=0;i<mBindings.size();i++)
+        if(mBindings[i].slot<0)
+            mBindings[i].slot = slot(mBindings[i].name);
+}
+
+int QcValueBus::poll()
+{
+    QC_TRACE_SCOPE("pollBus","ingest");
+    if(!isAttached())
+        return 0;
+    int count = slotCount();
+    if(count!=mResolvedCount){
+        mResolvedCount = count;
+        resolve();
+    }
+
+    // one acquire load per binding when nothing changed
+    mChanged.resize(0);
+    for(int i=0;i<mBindings.size();i++){
+        Binding &b = mBindings[i];
+        if(b.slot<0 || !b.item)
+            continue;
+        quint32 v = version(b.slot);
+        if(v==b.version)
+            continue;
+        QcChannelValue change;
+        if(!read(b.slot,&change.value,&change.stamp))
+            continue;
+        b.version = v;
+        change.item = b.item;
+        change.handle = b.handle;
+        mChanged.append(change);
+    }
+    if(!mChanged.isEmpty())
+        QcValueBatch::apply(mChanged.constData(),mChanged.size());
+    return mChanged.size();
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const char qcNmeaFormatters[][4] = {"MWV","MWV","MWV","MWV","HDG","VHW"};
+static const int qcNmeaFields[] = {1,3,1,3,1,5};
+
+// decimal field without exponent, as NMEA writes them; no locale, no allocation
+static bool qcParseNmeaNumber(const char *p, float *value)
+{
+    static const double scale[] = {1,1e-1,1e-2,1e-3,1e-4,1e-5,1e-6,1e-7,1e-8,1e-9};
+    bool negative = *p=='-';
+    if(*p=='-' || *p=='+')
+        p++;
+    qint64 mantissa = 0;
+    int digits = 0;
+    int decimals = 0;
+    for(;*p>='0' && *p<='9';p++,digits++)
+        if(digits<18)
+            mantissa = mantissa*10+(*p-'0');
+    if(*p=='.'){
+        for(p++;*p>='0' && *p<='9';p++,digits++){
+            if(decimals<9 && digits<18){
+                mantissa = mantissa*10+(*p-'0');
+                decimals++;
+            }
+        }
+    }
+    if(digits==0 || *p)
+        return false;
+    double v = mantissa*scale[decimals];
+    *value = negative ? -v : v;
+    return true;
+}
+
+static inline int qcHexDigit(char c)
+{
+    if(c>='0' && c<='9')
+        return c-'0';
+    if(c>='A' && c<='F')
+        return c-'A'+10;
+    if(c>='a' && c<='f')
+        return c-'a'+10;
+    return -1;
+}
+
+QcNmeaReader::QcNmeaReader(QObject *parent) :
+    QObject(parent)
+{
+    mLength = 0;
+    mOverflow = false;
+    mPending = false;
+    mReceived = 0;
+    mDevice = 0;
+    mSentences = 0;
+    mChecksumErrors = 0;
+}
+
+void QcNmeaReader::bind(Quantity quantity, QcItem *item, int handle)
+{
+    bind(qcNmeaFormatters[quantity],qcNmeaFields[quantity],item,handle);
+    mBindings.last().quantity = quantity;
+}
+
+void QcNmeaReader::bind(const char *formatter, int field, QcItem *item, int handle)
+{
+    Binding b;
+    memset(b.formatter,0,sizeof(b.formatter));
+    strncpy(b.formatter,formatter,3);
+    b.field = field;
+    b.quantity = -1;
+    b.item = item;
+    b.handle = handle;
+    b.pending = false;
+    b.value = 0;
+    b.stamp = 0;
+    mBindings.append(b);
+}
+
+void QcNmeaReader::unbind(QcItem *item)
+{
+    for(int i=mBindings.size()-1;i>=0;i--)
+        if(mBindings[i].item==item)
+            mBindings.remove(i);
+}
+
+void QcNmeaReader::setDevice(QIODevice *device)
+{
+    if(mDevice)
+        disconnect(mDevice,0,this,0);
+    mDevice = device;
+    if(mDevice)
+        connect(mDevice,&QIODevice::readyRead,this,&QcNmeaReader::readDevice);
+}
+
+void QcNmeaReader::readDevice()
+{
+    readFrom(mDevice);
+}
+
+qint64 QcNmeaReader::readFrom(QIODevice *device)
+{
+    // everything available is parsed before the values are applied once
+    char buffer[4096];
+    qint64 total = 0;
+    for(;;){
+        qint64 n = device->read(buffer,sizeof(buffer));
+        if(n<=0)
+            break;
+        scan(buffer,int(n));
+        total += n;
+    }
+    apply();
+    return total;
+}
+
+void QcNmeaReader::feed(const char *data, int size)
+{
+    scan(data,size);
+    apply();
+}
+
+quint64 QcNmeaReader::sentences()
+{
+    return mSentences;
+}
+
+quint64 QcNmeaReader::checksumErrors()
+{
+    return mChecksumErrors;
+}
+
+void QcNmeaReader::scan(const char *data, int size)
+{
+    QC_TRACE_SCOPE("scanNmea","ingest");
+    // NMEA has no acquisition time of its own, the receive time stands in
+    mReceived = QcValueBus::timestamp();
+    for(int i=0;i<size;i++){
+        char c = data[i];
+        if(c=='\r' || c=='\n'){
+            if(mLength>0 && !mOverflow)
+                parseSentence(mLine,mLength);
+            mLength = 0;
+            mOverflow = false;
+            continue;
+        }
+        // a start delimiter resyncs after a line lost its end
+        if(c=='$' || c=='!'){
+            mLength = 0;
+            mOverflow = false;
+        }
+        if(mLength<MaxSentence-1)
+            mLine[mLength++] = c;
+        else
+            mOverflow = true;
+    }
+}
+
+void QcNmeaReader::parseSentence(char *sentence, int length)
+{
+    if(sentence[0]!='$' && sentence[0]!='!')
+        return;
+    mSentences++;
+
+    // the checksum is optional in 0183, but checked when present
+    int end = length;
+    const char *star = static_cast<const char*>(memchr(sentence,'*',length));
+    if(star){
+        end = star-sentence;
+        int high = end+1<length ? qcHexDigit(sentence[end+1]) : -1;
+        int low = end+2<length ? qcHexDigit(sentence[end+2]) : -1;
+        quint8 sum = 0;
+        for(int i=1;i<end;i++)
+            sum ^= quint8(sentence[i]);
+        if(high<0 || low<0 || sum!=quint8(high<<4|low)){
+            mChecksumErrors++;
+            return;
+        }
+    }
+    sentence[end] = 0;
+
+    // fields are cut in place, field 0 is the address
+    const char *fields[MaxFields];
+    int count = 1;
+    fields[0] = sentence+1;
+    for(char *p=sentence+1;*p;p++){
+        if(*p==','){
+            *p = 0;
+            if(count<MaxFields)
+                fields[count++] = p+1;
+        }
+    }
+    // talker and formatter, proprietary sentences don't have this shape
+    if(strlen(fields[0])!=5 || fields[0][0]=='P')
+        return;
+    const char *formatter = fields[0]+2;
+
+    for(int i=0;i<mBindings.size();i++){
+        Binding &b = mBindings[i];
+        if(memcmp(b.formatter,formatter,3)!=0 || b.field>=count)
+            continue;
+        float value;
+        if(!qcParseNmeaNumber(fields[b.field],&value))
+            continue;
+
+        switch(b.quantity){
+        case ApparentWindAngle:
+        case ApparentWindSpeed:
+        case TrueWindAngle:
+        case TrueWindSpeed:{
+            // MWV: angle, reference R/T, speed, unit K/M/N, status A/V
+            char reference = b.quantity<=ApparentWindSpeed ? 'R' : 'T';
+            if(count<6 || fields[2][0]!=reference || fields[5][0]!='A')
+                continue;
+            if(b.field==1){
+                if(value>180)
+                    value -= 360;
+            }
+            else if(fields[4][0]=='K')
+                value *= 0.539957f;
+            else if(fields[4][0]=='M')
+                value *= 1.943844f;
+            break;
+        }
+        default:
+            break;
+        }
+        b.value = value;
+        b.stamp = mReceived;
+        b.pending = true;
+        mPending = true;
+    }
+}
+
+void QcNmeaReader::apply()
+{
+    if(!mPending)
+        return;
+    mPending = false;
+    mChanged.resize(0);
+    for(int i=0;i<mBindings.size();i++){
+        Binding &b = mBindings[i];
+        if(!b.pending)
+            continue;
+        b.pending = false;
+        if(!b.item)
+            continue;
+        QcChannelValue change;
+        change.item = b.item;
+        change.handle = b.handle;
+        change.value = b.value;
+        change.stamp = b.stamp;
+        mChanged.append(change);
+    }
+    QcValueBatch::apply(mChanged.constData(),mChanged.size());
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static inline quint32 qcPathHash(const char *path, int length)
+{
+    // FNV-1a
+    quint32 h = 2166136261u;
+    for(int i=0;i<length;i++)
+        h = (h^quint8(path[i]))*16777619u;
+    return h;
+}
+
+// Walks one delta message in place. Only the levels leading to
+// updates[].values[] are looked into, everything else is skipped.
+class QcDeltaScanner
+{
+public:
+    QcDeltaScanner(const char *begin, const char *end, QcSignalKReader *reader) :
+        p(begin), mEnd(end), mReader(reader) {}
+
+    bool message()
+    {
+        space();
+        return peek()=='{' && object(Message,0);
+    }
+
+private:
+    enum Kind{Skip,Message,Update,Value};
+
+    char peek()
+    {
+        return p<mEnd ? *p : 0;
+    }
+
+    void space()
+    {
+        while(p<mEnd && (*p==' ' || *p=='\t' || *p=='\r' || *p=='\n'))
+            p++;
+    }
+
+    static bool is(const char *key, int length, const char *name)
+    {
+        return int(strlen(name))==length && memcmp(key,name,length)==0;
+    }
+
+    // the raw bytes between the quotes, escapes are left as they are
+    bool string(const char **s, int *length)
+    {
+        if(peek()!='"')
+            return false;
+        const char *start = ++p;
+        for(;p<mEnd;p++){
+            if(*p=='\\')
+                p++;
+            else if(*p=='"'){
+                *s = start;
+                *length = p-start;
+                p++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool number(double *value)
+    {
+        bool negative = peek()=='-';
+        if(negative)
+            p++;
+        double mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        for(;p<mEnd && *p>='0' && *p<='9';p++,digits++)
+            mantissa = mantissa*10+(*p-'0');
+        if(peek()=='.'){
+            for(p++;p<mEnd && *p>='0' && *p<='9';p++,digits++,exponent--)
+                mantissa = mantissa*10+(*p-'0');
+        }
+        if(digits==0)
+            return false;
+        if(peek()=='e' || peek()=='E'){
+            p++;
+            bool negativeExponent = peek()=='-';
+            if(peek()=='-' || peek()=='+')
+                p++;
+            int e = 0;
+            for(;p<mEnd && *p>='0' && *p<='9';p++)
+                e = qMin(e*10+(*p-'0'),1000);
+            exponent += negativeExponent ? -e : e;
+        }
+        double v = exponent ? mantissa*qPow(10.0,exponent) : mantissa;
+        *value = negative ? -v : v;
+        return true;
+    }
+
+    bool skip(int depth)
+    {
+        space();
+        char c = peek();
+        if(c=='{')
+            return object(Skip,depth);
+        if(c=='[')
+            return array(Skip,depth);
+        if(c=='"'){
+            const char *s;
+            int length;
+            return string(&s,&length);
+        }
+        // numbers, true, false and null
+        const char *start = p;
+        while(p<mEnd && *p!=',' && *p!='}' && *p!=']' && *p!=' ' && *p!='\t' && *p!='\r' && *p!='\n')
+            p++;
+        return p>start;
+    }
+
+    bool array(Kind kind, int depth)
+    {
+        if(depth>QcSignalKReader::MaxDepth)
+            return false;
+        p++;
+        space();
+        if(peek()==']'){
+            p++;
+            return true;
+        }
+        for(;;){
+            space();
+            bool ok = kind!=Skip && peek()=='{' ? object(kind,depth+1) : skip(depth+1);
+            if(!ok)
+                return false;
+            space();
+            if(peek()==',')
+                p++;
+            else if(peek()==']'){
+                p++;
+                return true;
+            }
+            else
+                return false;
+        }
+    }
+
+    bool object(Kind kind, int depth)
+    {
+        if(depth>QcSignalKReader::MaxDepth)
+            return false;
+        p++;
+        const char *path = 0;
+        int pathLength = 0;
+        double value = 0;
+        bool numeric = false;
+
+        space();
+        if(peek()=='}')
+            p++;
+        else{
+            for(;;){
+                space();
+                const char *key;
+                int keyLength;
+                if(!string(&key,&keyLength))
+                    return false;
+                space();
+                if(peek()!=':')
+                    return false;
+                p++;
+                space();
+
+                bool ok;
+                char c = peek();
+                if(kind==Message && c=='[' && is(key,keyLength,"updates"))
+                    ok = array(Update,depth+1);
+                else if(kind==Update && c=='[' && is(key,keyLength,"values"))
+                    ok = array(Value,depth+1);
+                else if(kind==Value && c=='"' && is(key,keyLength,"path"))
+                    ok = string(&path,&pathLength);
+                else if(kind==Value && (c=='-' || (c>='0' && c<='9')) && is(key,keyLength,"value"))
+                    ok = numeric = number(&value);
+                else
+                    ok = skip(depth+1);
+                if(!ok)
+                    return false;
+
+                space();
+                if(peek()==',')
+                    p++;
+                else if(peek()=='}'){
+                    p++;
+                    break;
+                }
+                else
+                    return false;
+            }
+        }
+        // path and value may come in either order
+        if(kind==Value && path && numeric)
+            mReader->setValue(path,pathLength,value);
+        return true;
+    }
+
+    const char *p;
+    const char *mEnd;
+    QcSignalKReader *mReader;
+};
+
+QcSignalKReader::QcSignalKReader(QObject *parent) :
+    QObject(parent)
+{
+    mDepth = 0;
+    mInString = false;
+    mEscape = false;
+    mPending = false;
+    mReceived = 0;
+    mDevice = 0;
+    mMessages = 0;
+    mErrors = 0;
+}
+
+void QcSignalKReader::bind(const char *path, QcItem *item, int handle, float factor)
+{
+    Binding b;
+    b.path = QByteArray(path);
+    b.hash = qcPathHash(b.path.constData(),b.path.size());
+    b.item = item;
+    b.handle = handle;
+    b.factor = factor;
+    b.pending = false;
+    b.value = 0;
+    b.stamp = 0;
+    mBindings.append(b);
+    buildIndex();
+}
+
+void QcSignalKReader::unbind(QcItem *item)
+{
+    for(int i=mBindings.size()-1;i>=0;i--)
+        if(mBindings[i].item==item)
+            mBindings.remove(i);
+    buildIndex();
+}
+
+void QcSignalKReader::buildIndex()
+{
+    // at most half full, so probe runs stay short
+    int size = 16;
+    while(size<2*mBindings.size())
+        size *= 2;
+    mIndex.fill(-1,size);
+    for(int i=0;i<mBindings.size();i++){
+        int slot = mBindings[i].hash&(size-1);
+        while(mIndex[slot]>=0)
+            slot = (slot+1)&(size-1);
+        mIndex[slot] = i;
+    }
+}
+
+void QcSignalKReader::setDevice(QIODevice *device)
+{
+    if(mDevice)
+        disconnect(mDevice,0,this,0);
+    mDevice = device;
+    if(mDevice)
+        connect(mDevice,&QIODevice::readyRead,this,&QcSignalKReader::readDevice);
+}
+
+void QcSignalKReader::readDevice()
+{
+    readFrom(mDevice);
+}
+
+qint64 QcSignalKReader::readFrom(QIODevice *device)
+{
+    char buffer[4096];
+    qint64 total = 0;
+    for(;;){
+        qint64 n = device->read(buffer,sizeof(buffer));
+        if(n<=0)
+            break;
+        scan(buffer,int(n));
+        total += n;
+    }
+    apply();
+    return total;
+}
+
+void QcSignalKReader::feed(const char *data, int size)
+{
+    scan(data,size);
+    apply();
+}
+
+quint64 QcSignalKReader::messages()
+{
+    return mMessages;
+}
+
+quint64 QcSignalKReader::errors()
+{
+    return mErrors;
+}
+
+void QcSignalKReader::scan(const char *data, int size)
+{
+    QC_TRACE_SCOPE("scanSignalK","ingest");
+    // the delta timestamps are wall clock, latency is measured from receipt
+    mReceived = QcValueBus::timestamp();
+    // frames messages by bracket depth, outside of strings
+    for(int i=0;i<size;i++){
+        char c = data[i];
+        if(mDepth==0){
+            if(c=='{'){
+                mMessage.resize(0);
+                mMessage.append(c);
+                mDepth = 1;
+                mInString = false;
+                mEscape = false;
+            }
+            continue;
+        }
+        if(mMessage.size()>=MaxMessage){
+            mErrors++;
+            mDepth = 0;
+            continue;
+        }
+        mMessage.append(c);
+        if(mInString){
+            if(mEscape)
+                mEscape = false;
+            else if(c=='\\')
+                mEscape = true;
+            else if(c=='"')
+                mInString = false;
+        }
+        else if(c=='"')
+            mInString = true;
+        else if(c=='{' || c=='[')
+            mDepth++;
+        else if((c=='}' || c==']') && --mDepth==0)
+            parseMessage(mMessage.constData(),mMessage.constData()+mMessage.size());
+    }
+}
+
+void QcSignalKReader::parseMessage(const char *begin, const char *end)
+{
+    mMessages++;
+    QcDeltaScanner scanner(begin,end,this);
+    if(!scanner.message())
+        mErrors++;
+}
+
+void QcSignalKReader::setValue(const char *path, int length, double value)
+{
+    if(mIndex.isEmpty())
+        return;
+    quint32 hash = qcPathHash(path,length);
+    int mask = mIndex.size()-1;
+    // every binding of the path is in the same probe run
+    for(int slot=hash&mask;mIndex[slot]>=0;slot=(slot+1)&mask){
+        Binding &b = mBindings[mIndex[slot]];
+        if(b.hash!=hash || b.path.size()!=length || memcmp(b.path.constData(),path,length)!=0)
+            continue;
+        b.value = value*b.factor;
+        b.stamp = mReceived;
+        b.pending = true;
+        mPending = true;
+    }
+}
+
+void QcSignalKReader::apply()
+{
+    if(!mPending)
+        return;
+    mPending = false;
+    mChanged.resize(0);
+    for(int i=0;i<mBindings.size();i++){
+        Binding &b = mBindings[i];
+        if(!b.pending)
+            continue;
+        b.pending = false;
+        if(!b.item)
+            continue;
+        QcChannelValue change;
+        change.item = b.item;
+        change.handle = b.handle;
+        change.value = b.value;
+        change.stamp = b.stamp;
+        mChanged.append(change);
+    }
+    QcValueBatch::apply(mChanged.constData(),mChanged.size());
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// lets readers and buses write graph inputs through the QcItem channel interface
+class QcChannelGraphInput : public QcItem
+{
+public:
+    QcChannelGraphInput(QcChannelGraph *graph) :
+        QcItem(graph), mGraph(graph) {}
+    void draw(QPainter *) {}
+    void setChannelValue(int handle, float value)
+    {
+        if(handle<0 || handle>=mGraph->count())
+            return;
+        mGraph->setValue(handle,value,QcValueBatch::stamp());
+    }
+
+private:
+    QcChannelGraph *mGraph;
+};
+
+QcChannelGraph::QcChannelGraph(QObject *parent) :
+    QObject(parent)
+{
+    mInputItem = new QcChannelGraphInput(this);
+    mTimer = new QTimer(this);
+    mTimer->setSingleShot(true);
+    connect(mTimer,&QTimer::timeout,this,&QcChannelGraph::evaluate);
+    mFrameInterval = 16;
+    mScheduled = false;
+    mComputations = 0;
+}
+
+int QcChannelGraph::addInput(const char *name, float value)
+{
+    Node node;
+    node.name = QByteArray(name);
+    node.value = value;
+    node.stamp = 0;
+    node.dirty = false;
+    mNodes.append(node);
+    return mNodes.size()-1;
+}
+
+int QcChannelGraph::addDerived(const char *name, const QVector<int> &inputs, const Function &function)
+{
+    int channel = mNodes.size();
+    for(int i=0;i<inputs.size();i++)
+        if(inputs[i]<0 || inputs[i]>=channel)
+            return -1;
+    Node node;
+    node.name = QByteArray(name);
+    node.inputs = inputs;
+    node.function = function;
+    node.value = 0;
+    node.stamp = 0;
+    node.dirty = true;
+    mNodes.append(node);
+    for(int i=0;i<inputs.size();i++)
+        mNodes[inputs[i]].dependents.append(channel);
+    schedule();
+    return channel;
+}
+
+int QcChannelGraph::channel(const char *name)
+{
+    for(int i=0;i<mNodes.size();i++)
+        if(mNodes[i].name==name)
+            return i;
+    return -1;
+}
+
+int QcChannelGraph::count()
+{
+    return mNodes.size();
+}
+
+void QcChannelGraph::setValue(int channel, float value, qint64 stamp)
+{
+    if(channel<0 || channel>=mNodes.size())
+        return;
+    Node &node = mNodes[channel];
+    if(node.function || node.value==value)
+        return;
+    node.value = value;
+    node.stamp = stamp;
+    for(int i=0;i<node.dependents.size();i++)
+        markDirty(node.dependents[i]);
+    schedule();
+}
+
+float QcChannelGraph::value(int channel)
+{
+    // pulled on demand, even when no gauge shows it
+    if(channel<0 || channel>=mNodes.size())
+        return 0;
+    if(mNodes[channel].dirty)
+        compute(channel);
+    return mNodes[channel].value;
+}
+
+QcItem *QcChannelGraph::inputItem()
+{
+    return mInputItem;
+}
+
+void QcChannelGraph::bind(int channel, QcItem *item, int handle)
+{
+    if(channel<0 || channel>=mNodes.size())
+        return;
+    Consumer consumer;
+    consumer.channel = channel;
+    consumer.item = item;
+    consumer.handle = handle;
+    consumer.sent = false;
+    consumer.value = 0;
+    mConsumers.append(consumer);
+    schedule();
+}
+
+void QcChannelGraph::unbind(QcItem *item)
+{
+    for(int i=mConsumers.size()-1;i>=0;i--)
+        if(mConsumers[i].item==item)
+            mConsumers.remove(i);
+}
+
+void QcChannelGraph::setFrameInterval(int msecs)
+{
+    mFrameInterval = qMax(msecs,0);
+}
+
+quint64 QcChannelGraph::computations()
+{
+    return mComputations;
+}
+
+void QcChannelGraph::markDirty(int channel)
+{
+    // a dirty channel has dirty dependents already
+    Node &node = mNodes[channel];
+    if(node.dirty)
+        return;
+    node.dirty = true;
+    for(int i=0;i<node.dependents.size();i++)
+        markDirty(node.dependents[i]);
+}
+
+void QcChannelGraph::compute(int channel)
+{
+    Node &node = mNodes[channel];
+    QVarLengthArray<float,16> inputs(node.inputs.size());
+    node.stamp = 0;
+    for(int i=0;i<node.inputs.size();i++){
+        int input = node.inputs[i];
+        if(mNodes[input].dirty)
+            compute(input);
+        inputs[i] = mNodes[input].value;
+        node.stamp = qMax(node.stamp,mNodes[input].stamp);
+    }
+    node.value = node.function(inputs.constData());
+    node.dirty = false;
+    mComputations++;
+}
+
+void QcChannelGraph::schedule()
+{
+    if(mScheduled)
+        return;
+    mScheduled = true;
+    mTimer->start(mFrameInterval);
+}
+
+bool QcChannelGraph::isVisible(QcItem *item)
+{
+    return item && (!item->parentGauge || item->parentGauge->isExposed());
+}
+
+void QcChannelGraph::evaluate()
+{
+    QC_TRACE_SCOPE("evaluateGraph","ingest");
+    mScheduled = false;
+
+    // channels feeding a visible consumer, directly or through others;
+    // inputs come before their dependents, so one backward pass does
+    int count = mNodes.size();
+    mNeeded.fill(0,count);
+    for(int i=0;i<mConsumers.size();i++)
+        if(isVisible(mConsumers[i].item))
+            mNeeded[mConsumers[i].channel] = 1;
+    for(int i=count-1;i>=0;i--){
+        if(!mNeeded[i])
+            continue;
+        const QVector<int> &inputs = mNodes[i].inputs;
+        for(int k=0;k<inputs.size();k++)
+            mNeeded[inputs[k]] = 1;
+    }
+
+    // channels nobody shows stay dirty, value() pulls them on demand
+    for(int i=0;i<count;i++)
+        if(mNodes[i].dirty && mNeeded[i])
+            compute(i);
+
+    mChanged.resize(0);
+    bool stale = false;
+    for(int i=0;i<mConsumers.size();i++){
+        Consumer &c = mConsumers[i];
+        if(!c.item)
+            continue;
+        const Node &node = mNodes[c.channel];
+        if(!isVisible(c.item)){
+            if(node.dirty || !c.sent || c.value!=node.value)
+                stale = true;
+            continue;
+        }
+        float value = node.value;
+        if(c.sent && c.value==value)
+            continue;
+        c.sent = true;
+        c.value = value;
+        QcChannelValue change;
+        change.item = c.item;
+        change.handle = c.handle;
+        change.value = value;
+        change.stamp = node.stamp;
+        mChanged.append(change);
+    }
+    if(!mChanged.isEmpty())
+        QcValueBatch::apply(mChanged.constData(),mChanged.size());
+
+    // hidden consumers missing a change are looked at again now and then,
+    // a gauge that is shown again then gets the values it missed
+    if(stale && !mScheduled)
+        mTimer->start(StaleInterval);
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcUpdateScheduler::QcUpdateScheduler(QObject *parent) :
+    QObject(parent)
+{
+    mRate[Critical] = 60;
+    mRate[Normal] = 30;
+    mRate[Background] = 1;
+    mTickBudget = 8;
+    for(int c=0;c<PriorityCount;c++){
+        mNext[c] = 0;
+        mServed[c] = 0;
+        mDeferred[c] = 0;
+        mStatistics[c].targetRate = mRate[c];
+        mStatistics[c].achievedRate = 0;
+        mStatistics[c].gauges = 0;
+        mStatistics[c].deferred = 0;
+    }
+    mTimer = new QTimer(this);
+    mTimer->setTimerType(Qt::PreciseTimer);
+    connect(mTimer,&QTimer::timeout,this,&QcUpdateScheduler::tick);
+    mClock.start();
+    mWindowStart = 0;
+    updateInterval();
+}
+
+QcUpdateScheduler::~QcUpdateScheduler()
+{
+    // detached gauges fall back to immediate updates
+    for(int c=0;c<PriorityCount;c++){
+        foreach (QcGaugeWidget *gauge, mGauges[c]) {
+            gauge->mScheduler = 0;
+            if(gauge->mSchedulePending){
+                gauge->mSchedulePending = false;
+                gauge->update();
+            }
+        }
+    }
+}
+
+QcUpdateScheduler *QcUpdateScheduler::instance()
+{
+    // owned by the application, so it goes away with the event loop
+    static QPointer<QcUpdateScheduler> scheduler;
+    if(!scheduler)
+        scheduler = new QcUpdateScheduler(QCoreApplication::instance());
+    return scheduler;
+}
+
+void QcUpdateScheduler::setTargetRate(Priority priority, float hz)
+{
+    mRate[priority] = qMax(hz,0.01f);
+    mStatistics[priority].targetRate = mRate[priority];
+    updateInterval();
+}
+
+float QcUpdateScheduler::targetRate(Priority priority)
+{
+    return mRate[priority];
+}
+
+void QcUpdateScheduler::setTickBudget(float msecs)
+{
+    // the estimated paint time the gauges of one tick may use, 0 means no limit
+    mTickBudget = msecs;
+}
+
+float QcUpdateScheduler::tickBudget()
+{
+    return mTickBudget;
+}
+
+QcUpdateScheduler::Statistics QcUpdateScheduler::statistics(Priority priority)
+{
+    // the timer stops when nothing is pending, the window is closed here then
+    qint64 now = mClock.elapsed();
+    if(now-mWindowStart>=1000)
+        closeWindow(now);
+    Statistics statistics = mStatistics[priority];
+    statistics.gauges = mGauges[priority].size();
+    return statistics;
+}
+
+void QcUpdateScheduler::addGauge(QcGaugeWidget *gauge)
+{
+    // a new gauge is due at once
+    gauge->mScheduledAt = mClock.elapsed()-qint64(1000/mRate[gauge->mPriority])-1;
+    mGauges[gauge->mPriority].append(gauge);
+}
+
+void QcUpdateScheduler::removeGauge(QcGaugeWidget *gauge)
+{
+    QVector<QcGaugeWidget*> &gauges = mGauges[gauge->mPriority];
+    int i = gauges.indexOf(gauge);
+    if(i<0)
+        return;
+    gauges.remove(i);
+    if(mNext[gauge->mPriority]>i)
+        mNext[gauge->mPriority]--;
+}
+
+void QcUpdateScheduler::request()
+{
+    if(!mTimer->isActive())
+        mTimer->start();
+}
+
+void QcUpdateScheduler::updateInterval()
+{
+    // ticks at the highest target rate
+    float rate = qMax(mRate[Critical],qMax(mRate[Normal],mRate[Background]));
+    mTimer->setInterval(qMax(1,int(1000/rate)));
+}
+
+void QcUpdateScheduler::tick()
+{
+    QC_TRACE_SCOPE("schedulerTick","schedule");
+    qint64 now = mClock.elapsed();
+    float spent = 0;
+    bool pending = false;
+
+    for(int c=0;c<PriorityCount;c++){
+        QVector<QcGaugeWidget*> &gauges = mGauges[c];
+        int count = gauges.size();
+        // half a tick of slack, or timer jitter would halve the rate
+        qint64 period = qint64(1000/mRate[c]-mTimer->interval()/2);
+        // served round robin, so a tight budget doesn't always skip the same gauges
+        int first = count ? mNext[c]%count : 0;
+        for(int k=0;k<count;k++){
+            int i = (first+k)%count;
+            QcGaugeWidget *gauge = gauges[i];
+            if(!gauge->mSchedulePending)
+                continue;
+            if(now-gauge->mScheduledAt<period){
+                pending = true;
+                continue;
+            }
+            if(mTickBudget>0 && spent>=mTickBudget){
+                mDeferred[c]++;
+                pending = true;
+                continue;
+            }
+            spent += gauge->mPaintTime;
+            gauge->mScheduledAt = now;
+            gauge->mSchedulePending = false;
+            gauge->update();
+            mServed[c]++;
+            mNext[c] = i+1;
+        }
+    }
+
+    if(now-mWindowStart>=1000)
+        closeWindow(now);
+
+    if(!pending)
+        mTimer->stop();
+}
+
+void QcUpdateScheduler::closeWindow(qint64 now)
+{
+    float seconds = (now-mWindowStart)/1000.0f;
+    for(int c=0;c<PriorityCount;c++){
+        int active = 0;
+        foreach (QcGaugeWidget *gauge, mGauges[c]) {
+            if(gauge->mScheduleActive)
+                active++;
+            gauge->mScheduleActive = gauge->mSchedulePending;
+        }
+        mStatistics[c].achievedRate = active ? mServed[c]/seconds/active : 0;
+        mStatistics[c].deferred = mDeferred[c];
+        mServed[c] = 0;
+        mDeferred[c] = 0;
+    }
+    mWindowStart = now;
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcItem::QcItem(QObject *parent) :
+    QObject(parent)
+{
+
+    parentWidget = qobject_cast<QWidget*>(parent);
+    parentGauge = qobject_cast<QcGaugeWidget*>(parent);
+    mPosition = 50;
+    mQuality = parentGauge ? parentGauge->quality() : QcGaugeWidget::FullQuality;
+}
+
+int QcItem::type()
+{
+    return 50;
+}
+
+QcItemSnapshot *QcItem::snapshot()
+{
+    // items without a snapshot are drawn on the GUI thread
+    return 0;
+}
+
+bool QcItem::isStatic()
+{
+    // static items only change with their settings and the widget size,
+    // QcGaugeWidget caches them as images
+    return false;
+}
+
+void QcItem::applyDeferred()
+{
+}
+
+bool QcItem::deferChanges()
+{
+    // true while the gauge is hidden or a value batch is open; without a
+    // gauge there's no one to apply deferred work
+    return parentGauge && (!parentGauge->isExposed() || QcValueBatch::isActive());
+}
+
+void QcItem::defer()
+{
+    // applyDeferred() is called before the next paint
+    if(parentGauge)
+        parentGauge->mDeferred = true;
+}
+
+void QcItem::setChannelValue(int, float)
+{
+}
+
+qint64 QcItem::cacheBytes()
+{
+    return 0;
+}
+
+void QcItem::dropValue()
+{
+    // the value equals the one shown, nothing to repaint
+    if(parentGauge)
+        parentGauge->countDroppedValue();
+}
+
+void QcItem::update()
+{
+    if(parentGauge){
+        parentGauge->countUpdate();
+        parentGauge->requestFrame();
+    }
+    else if(parentWidget)
+        parentWidget->update();
+}
+
+void QcItem::update(const QRectF &rect)
+{
+    if(parentGauge){
+        parentGauge->countUpdate();
+        parentGauge->requestFrame(rect.toAlignedRect());
+    }
+    else if(parentWidget)
+        parentWidget->update(rect.toAlignedRect());
+}
+
+void QcItem::invalidateCache()
+{
+    if(parentGauge)
+        parentGauge->invalidateCache();
+    else
+        update();
+}
+
+float QcItem::position()
+{
+    return mPosition;
+}
+
+QRectF QcItem::rect()
+{
+    return mRect;
+}
+
+void QcItem::setQuality(int quality)
+{
+    mQuality = quality;
+}
+
+int QcItem::quality()
+{
+    return mQuality;
+}
+
+void QcItem::setPosition(float position)
+{
+    if(position>100)
+        mPosition = 100;
+    else if(position<0)
+        mPosition = 0;
+    else
+        mPosition = position;
+    if(isStatic())
+        invalidateCache();
+    else
+        update();
+}
+
+QRectF QcItem::adjustRect(float percentage)
+{
+    return adjustRect(mRect,percentage);
+}
+
+float QcItem::getRadius(const QRectF &tmpRect)
+{
+    return radius(tmpRect);
+}
+
+QRectF QcItem::resetRect()
+{
+    mRect = squareRect(parentWidget->rect());
+    return mRect;
+}
+
+QPointF QcItem::getPoint(float deg,const QRectF &tmpRect)
+{
+    return pointAt(deg,tmpRect);
+}
+
+QRectF QcItem::squareRect(const QRect &widgetRect)
+{
+    QRectF tmpRect = widgetRect;
+    float r = radius(tmpRect);
+    tmpRect.setWidth(2.0*r);
+    tmpRect.setHeight(2.0*r);
+    tmpRect.moveCenter(widgetRect.center());
+    return tmpRect;
+}
+
+QRectF QcItem::adjustRect(const QRectF &rect, float percentage)
+{
+    float r = radius(rect);
+    float offset =   r-(percentage*r)/100.0;
+    QRectF tmpRect = rect.adjusted(offset,offset,-offset,-offset);
+    return tmpRect;
+}
+
+float QcItem::radius(const QRectF &tmpRect)
+{
+    float r = 0;
+    if(tmpRect.width()<tmpRect.height())
+        r = tmpRect.width()/2.0;
+    else
+        r = tmpRect.height()/2.0;
+    return r;
+}
+
+QPointF QcItem::pointAt(float deg,const QRectF &tmpRect)
+{
+    float r = radius(tmpRect);
+    float xx=cos(qDegreesToRadians(deg))*r;
+    float yy=sin(qDegreesToRadians(deg))*r;
+    QPointF pt;
+    xx=tmpRect.center().x()-xx;
+    yy=tmpRect.center().y()-yy;
+    pt.setX(xx);
+    pt.setY(yy);
+    return pt;
+}
+
+
+
+float QcItem::getAngle(const QPointF&pt, const QRectF &tmpRect)
+{
+    float xx=tmpRect.center().x()-pt.x();
+    float yy=tmpRect.center().y()-pt.y();
+    return qRadiansToDegrees( atan2(yy,xx));
+}
+
+QcItemSnapshot::~QcItemSnapshot()
+{
+}
+
+void QcItemSnapshot::prepare(const QRectF &, qreal)
+{
+}
+
+template<typename State>
+class QcStateSnapshot : public QcItemSnapshot
+{
+public:
+    QcStateSnapshot(const State &state) : mState(state) {}
+    void prepare(const QRectF &rect, qreal ratio)
+    {
+        mState.prepare(rect,ratio);
+    }
+    void draw(QPainter *painter, const QRectF &rect)
+    {
+        mState.paint(painter,rect);
+    }
+
+private:
+    State mState;
+};
+
+template<typename State>
+class QcScaleStateSnapshot : public QcItemSnapshot
+{
+public:
+    QcScaleStateSnapshot(const State &state, const QSharedPointer<QcScale> &scale) :
+        mState(state), mScale(scale) {}
+    void prepare(const QRectF &rect, qreal ratio)
+    {
+        mState.prepare(rect,*mScale,ratio);
+    }
+    void draw(QPainter *painter, const QRectF &rect)
+    {
+        mState.paint(painter,rect,*mScale);
+    }
+
+private:
+    State mState;
+    QSharedPointer<QcScale> mScale;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcTickGenerator::QcTickGenerator()
+{
+    mMinValue = 0;
+    mMaxValue = 100;
+    mStep = 10;
+    mLength = 0;
+    mMinSpacing = 0;
+    mEffectiveStep = 0;
+    mDirty = true;
+    mRevision = 0;
+}
+
+void QcTickGenerator::setRange(float minValue, float maxValue)
+{
+    if(minValue==mMinValue && maxValue==mMaxValue)
+        return;
+    mMinValue = minValue;
+    mMaxValue = maxValue;
+    mDirty = true;
+}
+
+void QcTickGenerator::setStep(float step)
+{
+    if(step==mStep)
+        return;
+    mStep = step;
+    mDirty = true;
+}
+
+void QcTickGenerator::setLength(float length)
+{
+    if(length==mLength)
+        return;
+    mLength = length;
+    // the length only matters when the step is chosen from the pixel spacing
+    if(mMinSpacing>0)
+        mDirty = true;
+}
+
+void QcTickGenerator::setAutoSpacing(float minSpacing)
+{
+    if(minSpacing==mMinSpacing)
+        return;
+    mMinSpacing = minSpacing;
+    mDirty = true;
+}
+
+float QcTickGenerator::step()
+{
+    return mStep;
+}
+
+float QcTickGenerator::effectiveStep()
+{
+    if(mDirty)
+        generate();
+    return mEffectiveStep;
+}
+
+float QcTickGenerator::autoSpacing()
+{
+    return mMinSpacing;
+}
+
+const QVector<float> &QcTickGenerator::ticks()
+{
+    if(mDirty){
+        qcCountCache(QcRenderStatistics::TickCache,mRevision>0 ? QcCacheRebuild : QcCacheMiss);
+        generate();
+    }
+    else
+        qcCountCache(QcRenderStatistics::TickCache,QcCacheHit);
+    return mTicks;
+}
+
+int QcTickGenerator::revision()
+{
+    if(mDirty)
+        generate();
+    return mRevision;
+}
+
+float QcTickGenerator::niceStep(float range, int maxCount)
+{
+    if(!(range>0) || maxCount<1)
+        return 0;
+    double rough = double(range)/maxCount;
+    double magnitude = std::pow(10.0,std::floor(std::log10(rough)));
+    double fraction = rough/magnitude;
+    double nice;
+    if(fraction<=1)
+        nice = 1;
+    else if(fraction<=2)
+        nice = 2;
+    else if(fraction<=5)
+        nice = 5;
+    else
+        nice = 10;
+    return nice*magnitude;
+}
+
+void QcTickGenerator::generate()
+{
+    QC_TRACE_SCOPE("generateTicks","cache");
+    mDirty = false;
+    mRevision++;
+    mTicks.clear();
+    mEffectiveStep = 0;
+
+    double range = double(mMaxValue)-mMinValue;
+    if(!qIsFinite(range) || range<0)
+        return;
+
+    double step = mStep;
+    if(mMinSpacing>0 && mLength>0){
+        // never pack the ticks closer than mMinSpacing pixels
+        int maxCount = qMax(1,int(mLength/mMinSpacing));
+        double autoStep = niceStep(range,maxCount);
+        if(!(step>0) || step<autoStep)
+            step = autoStep;
+    }
+    if(!(step>0) || !qIsFinite(step)){
+        if(range==0)
+            mTicks.append(mMinValue);
+        return;
+    }
+
+    // the small epsilon keeps the last tick when range is a multiple of step
+    double count = std::floor(range/step+1e-4)+1;
+    if(count>MaxTicks){
+        // coarsen by a 2/5/10 multiple of the requested step, so ticks stay aligned
+        step *= niceStep(float(count),MaxTicks);
+        count = std::floor(range/step+1e-4)+1;
+    }
+
+    mEffectiveStep = step;
+    int n = int(count);
+    mTicks.reserve(n);
+    for(int i = 0;i<n;i++)
+        mTicks.append(float(mMinValue+i*step));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcScaleMapping::~QcScaleMapping()
+{
+}
+
+float QcLogMapping::fraction(float value, float minValue, float maxValue) const
+{
+    // a true log scale needs a positive range, otherwise log the distance from min
+    if(minValue>0)
+        return std::log(value/minValue)/std::log(maxValue/minValue);
+    return std::log1p(value-minValue)/std::log1p(maxValue-minValue);
+}
+
+float QcSqrtMapping::fraction(float value, float minValue, float maxValue) const
+{
+    return std::sqrt((value-minValue)/(maxValue-minValue));
+}
+
+QcPiecewiseMapping::QcPiecewiseMapping(const QList<QPair<float, float> > &points)
+{
+    mPoints = points;
+    std::sort(mPoints.begin(),mPoints.end());
+}
+
+float QcPiecewiseMapping::fraction(float value, float minValue, float maxValue) const
+{
+    if(mPoints.size()<2)
+        return (value-minValue)/(maxValue-minValue);
+    if(value<=mPoints.first().first)
+        return mPoints.first().second;
+    for(int i = 1;i<mPoints.size();i++){
+        const QPair<float,float> &p0 = mPoints[i-1];
+        const QPair<float,float> &p1 = mPoints[i];
+        if(value<=p1.first){
+            if(p1.first==p0.first)
+                return p1.second;
+            return p0.second+(p1.second-p0.second)*(value-p0.first)/(p1.first-p0.first);
+        }
+    }
+    return mPoints.last().second;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static std::atomic<int> qcScaleRevision(0);
+
+QcScale::QcScale(QObject *parent) :
+    QObject(parent)
+{
+    mMinDegree = -45;
+    mMaxDegree = 225;
+    mMinValue = 0;
+    mMaxValue = 100;
+    mDegreeOffset = 0;
+    mRevision = 0;
+    updateMapping();
+}
+
+void QcScale::setValueRange(float minValue, float maxValue)
+{
+    if (minValue < maxValue) {
+        mMinValue = minValue;
+        mMaxValue = maxValue;
+        updateMapping();
+    } else throw (QcItem::InvalidValueRange);
+}
+
+void QcScale::setDegreeRange(float minDegree, float maxDegree)
+{
+    if (minDegree < maxDegree) {
+        mMinDegree = minDegree;
+        mMaxDegree = maxDegree;
+        updateMapping();
+    } else throw (QcItem::InvalidValueRange);
+}
+
+void QcScale::setMinValue(float minValue)
+{
+    if(minValue>mMaxValue)
+        throw (QcItem::InvalidValueRange);
+    mMinValue = minValue;
+    updateMapping();
+}
+
+void QcScale::setMaxValue(float maxValue)
+{
+    if(maxValue<mMinValue )
+        throw (QcItem::InvalidValueRange);
+    mMaxValue = maxValue;
+    updateMapping();
+}
+
+void QcScale::setMinDegree(float minDegree)
+{
+    if(minDegree>mMaxDegree)
+        throw (QcItem::InvalidDegreeRange);
+    mMinDegree = minDegree;
+    updateMapping();
+}
+
+void QcScale::setMaxDegree(float maxDegree)
+{
+    if(maxDegree<mMinDegree)
+        throw (QcItem::InvalidDegreeRange);
+    mMaxDegree = maxDegree;
+    updateMapping();
+}
+
+void QcScale::setDegreeOffset(float degreeOffset)
+{
+    mDegreeOffset = degreeOffset;
+    updateMapping();
+}
+
+void QcScale::setMapping(const QSharedPointer<QcScaleMapping> &mapping)
+{
+    mMapping = mapping;
+    updateMapping();
+}
+
+float QcScale::minValue() const
+{
+    return mMinValue;
+}
+
+float QcScale::maxValue() const
+{
+    return mMaxValue;
+}
+
+float QcScale::minDegree() const
+{
+    return mMinDegree;
+}
+
+float QcScale::maxDegree() const
+{
+    return mMaxDegree;
+}
+
+float QcScale::degreeOffset() const
+{
+    return mDegreeOffset;
+}
+
+QSharedPointer<QcScaleMapping> QcScale::mapping() const
+{
+    return mMapping;
+}
+
+int QcScale::revision() const
+{
+    return mRevision;
+}
+
+void QcScale::copyFrom(const QcScale &other)
+{
+    // takes the whole mapping without emitting changed()
+    mMinValue = other.mMinValue;
+    mMaxValue = other.mMaxValue;
+    mMinDegree = other.mMinDegree;
+    mMaxDegree = other.mMaxDegree;
+    mDegreeOffset = other.mDegreeOffset;
+    mRevision = other.mRevision;
+    mMapping = other.mMapping;
+    mSlope = other.mSlope;
+    mIntercept = other.mIntercept;
+    mTableScale = other.mTableScale;
+    mTable = other.mTable;
+}
+
+void QcScale::updateMapping()
+{
+    QC_TRACE_SCOPE("updateMapping","cache");
+    // linear coefficients, also used as the fallback for an empty range
+    float range = mMaxValue-mMinValue;
+    mSlope = range!=0 ? (mMaxDegree-mMinDegree)/range : 0;
+    mIntercept = mDegreeOffset-mSlope*mMinValue+mMinDegree;
+    mTableScale = 0;
+    mTable.clear();
+
+    if(!mMapping.isNull() && range>0){
+        // sample the mapping at MappingTableSize intervals, lookups interpolate between them
+        mTable.resize(MappingTableSize+1);
+        mTableScale = MappingTableSize/range;
+        float sweep = mMaxDegree-mMinDegree;
+        for(int i = 0;i<=MappingTableSize;i++){
+            float v = mMinValue+i*range/MappingTableSize;
+            float f = mMapping->fraction(v,mMinValue,mMaxValue);
+            if(qIsFinite(f))
+                mTable[i] = mDegreeOffset+mMinDegree+sweep*f;
+            else
+                mTable[i] = i==0 ? mDegreeOffset+mMinDegree : mTable[i-1];
+        }
+    }
+
+    // unique across scales, an item switching to another scale can't
+    // find its caches matching by chance
+    mRevision = ++qcScaleRevision;
+    emit changed();
+}
+
+float QcScale::degFromValue(float v) const
+{
+    if(mTable.isEmpty())
+        return mSlope*v+mIntercept;
+    float t = (v-mMinValue)*mTableScale;
+    if(!(t>0)) // also catches nan
+        return mTable[0];
+    if(t>=MappingTableSize)
+        return mTable[MappingTableSize];
+    int i = int(t);
+    return mTable[i]+(mTable[i+1]-mTable[i])*(t-i);
+}
+
+void QcScale::degFromValues(const float *values, float *degrees, int count) const
+{
+    if(mTable.isEmpty()){
+        for(int i = 0;i<count;i++)
+            degrees[i] = mSlope*values[i]+mIntercept;
+        return;
+    }
+    const float *table = mTable.constData();
+    for(int i = 0;i<count;i++){
+        float t = qBound(0.0f,(values[i]-mMinValue)*mTableScale,float(MappingTableSize));
+        int j = qMin(int(t),MappingTableSize-1);
+        degrees[i] = table[j]+(table[j+1]-table[j])*(t-j);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static inline qreal qcDeviceRatio(QPainter *painter)
+{
+    return painter->device() ? painter->device()->devicePixelRatioF() : 1;
+}
+
+QcBackgroundState::QcBackgroundState()
+{
+    position = 88;
+    pen = Qt::NoPen;
+    colors.append(QPair<float,QColor>(0.4,Qt::darkGray));
+    colors.append(QPair<float,QColor>(0.8,Qt::black));
+    quality = QcGaugeWidget::FullQuality;
+    brushFlat = false;
+}
+
+void QcBackgroundState::draw(QPainter *painter, const QRectF &rect)
+{
+    bool flat = quality>=QcGaugeWidget::FlatFills;
+    if(brushRect!=rect || brushFlat!=flat || brushColors!=colors){
+        brushRect = rect;
+        brushFlat = flat;
+        brushColors = colors;
+        brush = QBrush();
+        if(flat){
+            // the color nearest to the middle of the gradient
+            int middle = -1;
+            for(int i = 0;i<colors.size();i++)
+                if(middle<0 || qAbs(colors[i].first-0.5)<qAbs(colors[middle].first-0.5))
+                    middle = i;
+            if(middle>=0)
+                brush = QBrush(colors[middle].second);
+        }
+        else{
+            QLinearGradient linearGrad(rect.topLeft(), rect.bottomRight());
+            for(int i = 0;i<colors.size();i++){
+                linearGrad.setColorAt(colors[i].first,colors[i].second);
+            }
+            brush = QBrush(linearGrad);
+        }
+    }
+    painter->setPen(pen);
+    painter->setBrush(brush);
+    painter->drawEllipse(QcItem::adjustRect(rect,position));
+}
+
+QcGlassState::QcGlassState()
+{
+    position = 88;
+    quality = QcGaugeWidget::FullQuality;
+    brushFlat = false;
+}
+
+void QcGlassState::draw(QPainter *painter, const QRectF &rect)
+{
+    QRectF tmpRect1 = QcItem::adjustRect(rect,position);
+    QRectF tmpRect2 = tmpRect1;
+    float r = QcItem::radius(tmpRect1);
+    tmpRect2.setHeight(r/2.0);
+    painter->setPen(Qt::NoPen);
+
+    bool flat = quality>=QcGaugeWidget::FlatFills;
+    if(brush.style()==Qt::NoBrush || brushRect!=tmpRect1 || brushFlat!=flat){
+        QColor clr1 = Qt::gray ;
+        QColor clr2 = Qt::white;
+        clr1.setAlphaF(0.2);
+        clr2.setAlphaF(0.4);
+
+        if(flat)
+            brush = QBrush(clr1);
+        else{
+            QLinearGradient linearGrad1(tmpRect1.topLeft(), tmpRect1.bottomRight());
+            linearGrad1.setColorAt(0.1, clr1);
+            linearGrad1.setColorAt(0.5, clr2);
+            brush = QBrush(linearGrad1);
+        }
+        brushRect = tmpRect1;
+        brushFlat = flat;
+    }
+    painter->setBrush(brush);
+    painter->drawPie(tmpRect1,0,16*180);
+    tmpRect2.moveCenter(rect.center());
+    painter->drawPie(tmpRect2,0,-16*180);
+}
+
+QcArcState::QcArcState()
+{
+    position = 80;
+    color = Qt::black;
+}
+
+void QcArcState::draw(QPainter *painter, const QRectF &rect, const QcScale &scale)
+{
+    prepare(rect,scale,qcDeviceRatio(painter));
+    paint(painter,rect,scale);
+}
+
+void QcArcState::prepare(const QRectF &rect, const QcScale &, qreal)
+{
+    float r = QcItem::radius(QcItem::adjustRect(rect,position));
+    if(pen.color()!=color || pen.widthF()!=r/40){
+        pen = QPen(color);
+        pen.setWidthF(r/40);
+    }
+}
+
+void QcArcState::paint(QPainter *painter, const QRectF &rect, const QcScale &scale) const
+{
+    QRectF tmpRect= QcItem::adjustRect(rect,position);
+    painter->setPen(pen);
+    painter->drawArc(tmpRect,-16*(scale.minDegree()+180),-16*(scale.maxDegree()-scale.minDegree()));
+}
+
+QcColorBandState::QcColorBandState()
+{
+    position = 50;
+    d = QSharedPointer<Cache>(new Cache);
+    d->width = 0;
+
+    QPair<QColor,float> pair;
+
+    pair.first = Qt::green;
+    pair.second = 10;
+    colors.append(pair);
+
+    pair.first = Qt::darkGreen;
+    pair.second = 50;
+    colors.append(pair);
+
+    pair.first = Qt::red;
+    pair.second = 100;
+    colors.append(pair);
+}
+
+void QcColorBandState::draw(QPainter *painter, const QRectF &rect, const QcScale &scale)
+{
+    paint(painter,rect,scale);
+}
+
+void QcColorBandState::prepare(const QRectF &rect, const QcScale &scale, qreal)
+{
+    segments(rect,scale);
+}
+
+void QcColorBandState::paint(QPainter *painter, const QRectF &rect, const QcScale &scale) const
+{
+    // an eviction after prepare() is rebuilt here
+    const QVector<Segment> fills = segments(rect,scale);
+    painter->setPen(Qt::NoPen);
+    for(int i=0;i<fills.size();i++)
+        painter->fillPath(fills[i].outline,fills[i].fill);
+}
+
+QVector<QcColorBandState::Segment> QcColorBandState::segments(const QRectF &rect, const QcScale &scale) const
+{
+    // the lock only covers the outlines being checked; tiles fill them from
+    // their own reference, so they don't wait for each other
+    QMutexLocker locker(&d->mutex);
+    d->touch();
+    float r = QcItem::radius(rect);
+    float width = r/20.0;
+    QRectF tmpRect = QcItem::adjustRect(rect,position);
+    QVector<Segment> &segments = d->segments;
+    // read through this one, a write access would detach the vector from
+    // the copies other tiles are filling
+    const QVector<Segment> &current = d->segments;
+    // outlines dropped here are rebuilt, not missed
+    int stale = 0;
+    if(tmpRect!=d->rect || width!=d->width){
+        stale = segments.size();
+        segments.clear();
+        d->rect = tmpRect;
+        d->width = width;
+    }
+    if(current.size()>colors.size())
+        segments.resize(colors.size());
+    bool rebuilt = false;
+
+    float offset = scale.degFromValue(scale.minValue());
+    for(int i = 0;i<colors.size();i++){
+        float sweep=0;
+        if(i==0)
+            sweep = scale.degFromValue(colors[i].second)-scale.degFromValue(scale.minValue());
+        else
+            sweep = scale.degFromValue(colors[i].second)-scale.degFromValue(colors[i-1].second);
+        if(i==current.size() || current[i].from!=-offset || current[i].sweep!=sweep){
+            QC_TRACE_SCOPE("strokeBand","cache");
+            qcCountCache(QcRenderStatistics::BandCache,i<current.size() || i<stale ? QcCacheRebuild : QcCacheMiss);
+            Segment segment;
+            segment.from = -offset;
+            segment.sweep = sweep;
+            QPainterPath path;
+            path.arcMoveTo(tmpRect,180-offset);
+            path.arcTo(tmpRect,180-offset,-sweep);
+            QPainterPathStroker stroker;
+            stroker.setCapStyle(Qt::FlatCap);
+            stroker.setWidth(width);
+            segment.outline = stroker.createStroke(path);
+            if(i==current.size())
+                segments.append(segment);
+            else
+                segments[i] = segment;
+            rebuilt = true;
+        }
+        else
+            qcCountCache(QcRenderStatistics::BandCache,QcCacheHit);
+        offset += sweep;
+        // a QColor would become a new QBrush on every fill
+        if(current[i].fill.color()!=colors[i].first || current[i].fill.style()==Qt::NoBrush)
+            segments[i].fill = QBrush(colors[i].first);
+    }
+    if(rebuilt || stale)
+        d->account();
+    return current;
+}
+
+QcDegreesState::QcDegreesState()
+{
+    position = 90;
+    color = Qt::black;
+    subDegree = false;
+    ticksRevision = -1;
+    scaleRevision = -1;
+    quality = QcGaugeWidget::FullQuality;
+    penWidth = -1;
+}
+
+void QcDegreesState::draw(QPainter *painter, const QRectF &rect, const QcScale &scale)
+{
+    prepare(rect,scale,qcDeviceRatio(painter));
+    paint(painter,rect,scale);
+}
+
+void QcDegreesState::prepare(const QRectF &rect, const QcScale &scale, qreal)
+{
+    if(subDegree && quality>=QcGaugeWidget::NoMinorTicks)
+        return;
+    QRectF tmpRect = QcItem::adjustRect(rect,position);
+
+    float r = QcItem::radius(tmpRect);
+    ticks.setRange(scale.minValue(),scale.maxValue());
+    ticks.setLength(r*qDegreesToRadians(scale.maxDegree()-scale.minDegree()));
+    const QVector<float> &values = ticks.ticks();
+    if(ticksRevision!=ticks.revision() || scaleRevision!=scale.revision() || linesRect!=tmpRect){
+        tickDegrees.resize(values.size());
+        scale.degFromValues(values.constData(),tickDegrees.data(),values.size());
+        ticksRevision = ticks.revision();
+        scaleRevision = scale.revision();
+        linesRect = tmpRect;
+
+        // from 3% to 13% of the way to the center
+        QPointF center = tmpRect.center();
+        tickLines.resize(values.size());
+        for(int i = 0;i<values.size();i++){
+            QPointF pt = QcItem::pointAt(tickDegrees[i],tmpRect);
+            tickLines[i] = QLineF(pt+(center-pt)*0.03,pt+(center-pt)*0.13);
+        }
+    }
+
+    float width = subDegree ? 0 : r/25.0;
+    if(pen.color()!=color || penWidth!=width){
+        pen = QPen(color);
+        if(!subDegree)
+            pen.setWidthF(width);
+        penWidth = width;
+    }
+}
+
+void QcDegreesState::paint(QPainter *painter, const QRectF &, const QcScale &) const
+{
+    if(subDegree && quality>=QcGaugeWidget::NoMinorTicks)
+        return;
+    painter->setPen(pen);
+    painter->drawLines(tickLines.constData(),tickLines.size());
+}
+
+QcValuesState::QcValuesState()
+{
+    position = 70;
+    color = Qt::black;
+    font = "Arial";
+    ticksRevision = -1;
+    scaleRevision = -1;
+    textFontSize = 0;
+}
+
+void QcValuesState::draw(QPainter *painter, const QRectF &rect, const QcScale &scale)
+{
+    prepare(rect,scale,qcDeviceRatio(painter));
+    paint(painter,rect,scale);
+}
+
+void QcValuesState::prepare(const QRectF &rect, const QcScale &scale, qreal ratio)
+{
+    float r = QcItem::radius(QcItem::adjustRect(rect,99));
+    if(textFontFamily!=font || textFontSize!=0.08f*r){
+        textFont = QFont(font,0, QFont::Bold);
+        textFont.setPointSizeF(0.08*r);
+        textFontFamily = font;
+        textFontSize = 0.08f*r;
+    }
+    if(atlas.isNull() || !atlas->matches(textFont,color,ratio)){
+        qcCountCache(QcRenderStatistics::GlyphCache,atlas.isNull() ? QcCacheMiss : QcCacheRebuild);
+        atlas = QcGlyphAtlas::atlas(textFont,color,ratio);
+    }
+    else
+        qcCountCache(QcRenderStatistics::GlyphCache,QcCacheHit);
+
+    ticks.setRange(scale.minValue(),scale.maxValue());
+    ticks.setLength(r*qDegreesToRadians(scale.maxDegree()-scale.minDegree()));
+    const QVector<float> &values = ticks.ticks();
+    if(ticksRevision!=ticks.revision() || scaleRevision!=scale.revision()){
+        tickDegrees.resize(values.size());
+        scale.degFromValues(values.constData(),tickDegrees.data(),values.size());
+        ticksRevision = ticks.revision();
+        scaleRevision = scale.revision();
+    }
+    // shares the generator's vector, paint() can't ask it
+    tickValues = values;
+}
+
+void QcValuesState::paint(QPainter *painter, const QRectF &rect, const QcScale &) const
+{
+    const QRectF &tmpRect = rect;
+    QPointF center = tmpRect.center();
+    float t = 1.0-position/100.0;
+    for(int i = 0;i<tickValues.size();i++){
+        char digits[32];
+        int length = QcGlyphAtlas::format(tickValues[i],-1,digits,sizeof(digits));
+        QPointF pt = QcItem::pointAt(tickDegrees[i],tmpRect);
+        QPointF textCenter = pt+(center-pt)*t;
+        QSizeF sz = atlas->size(digits,length);
+        atlas->draw(painter,textCenter-QPointF(sz.width()/2,sz.height()/2),digits,length);
+    }
+}
+
+qint64 QcColorBandState::cacheBytes() const
+{
+    return d->cacheBytes();
+}
+
+void QcColorBandState::Cache::account()
+{
+    // the path elements, the QPainterPath overhead is left out
+    qint64 bytes = 0;
+    for(int i=0;i<segments.size();i++)
+        bytes += segments[i].outline.elementCount()*qint64(sizeof(QPainterPath::Element));
+    setCacheBytes(bytes);
+}
+
+void QcColorBandState::Cache::evict()
+{
+    QMutexLocker locker(&mutex);
+    segments.clear();
+    setCacheBytes(0);
+}
+
+QcNeedleSprites::QcNeedleSprites()
+{
+    count = 0;
+    blending = false;
+    d = QSharedPointer<Cache>(new Cache);
+    d->radius = 0;
+    d->needleType = -1;
+    d->ratio = 0;
+    d->blendFirst = -1;
+    d->blendSecond = -1;
+    d->blendWeight = 0;
+}
+
+void QcNeedleSprites::clear()
+{
+    d->clear();
+}
+
+void QcNeedleSprites::Cache::clear()
+{
+    sprites.clear();
+    offsets.clear();
+    blend = QImage();
+    blendFirst = -1;
+    setCacheBytes(0);
+}
+
+void QcNeedleSprites::draw(QPainter *painter, const QcNeedleState &state, const QPointF &center, float r, float deg) const
+{
+    QMutexLocker locker(&d->mutex);
+    d->touch();
+    qreal ratio = qcDeviceRatio(painter);
+    if(d->sprites.size()!=count || d->radius!=r || d->needleType!=state.needleType
+            || d->color!=state.color || d->ratio!=ratio){
+        if(!d->sprites.isEmpty())
+            qcCountCache(QcRenderStatistics::SpriteCache,QcCacheRebuild);
+        d->clear();
+        d->sprites.resize(count);
+        d->offsets.resize(count);
+        d->radius = r;
+        d->needleType = state.needleType;
+        d->color = state.color;
+        d->ratio = ratio;
+    }
+
+    float pos = deg*count/360.0;
+    pos -= qFloor(pos/count)*count;
+    int first = qFloor(pos);
+    // weight of the second sprite in 1/256, without blending the nearest
+    // sprite is drawn alone
+    int weight = blending ? qRound((pos-first)*256) : (pos-first<0.5 ? 0 : 256);
+    int second = (first+1)%count;
+    first %= count;
+    if(weight==256){
+        first = second;
+        weight = 0;
+    }
+
+    int used[2] = {first,second};
+    for(int i=0;i<(weight>0 ? 2 : 1);i++){
+        if(d->sprites[used[i]].isNull()){
+            qcCountCache(QcRenderStatistics::SpriteCache,QcCacheMiss);
+            render(state,used[i]);
+        }
+        else
+            qcCountCache(QcRenderStatistics::SpriteCache,QcCacheHit);
+    }
+
+    // drawn from a reference after unlocking, tiles blit in parallel
+    QImage image;
+    QRect area;
+    if(weight==0){
+        image = d->sprites.at(first);
+        area = QRect(d->offsets.at(first),image.size());
+    }
+    else{
+        blend(first,second,weight);
+        image = d->blend;
+        area = d->blendRect;
+    }
+    locker.unlock();
+
+    // sprites are aligned to device pixels
+    QPointF origin(qRound(center.x()*ratio)/ratio,qRound(center.y()*ratio)/ratio);
+    painter->drawImage(QRectF(origin+QPointF(area.topLeft())/ratio,QSizeF(area.size())/ratio),
+                       image,QRectF(0,0,area.width(),area.height()));
+}
+
+// adds the pixels of source, scaled by weight/256, to target at offset;
+// premultiplied channels of two sprites with weights summing to 256 can't
+// overflow
+static void qcAddWeighted(QImage &target, const QImage &source, const QPoint &offset, int weight)
+{
+    for(int y=0;y<source.height();y++){
+        const quint32 *s = reinterpret_cast<const quint32*>(source.constScanLine(y));
+        quint32 *t = reinterpret_cast<quint32*>(target.scanLine(offset.y()+y))+offset.x();
+        for(int x=0;x<source.width();x++){
+            quint32 p = s[x];
+            quint32 rb = ((p&0x00ff00ff)*weight>>8)&0x00ff00ff;
+            quint32 ag = ((p>>8)&0x00ff00ff)*weight&0xff00ff00;
+            t[x] += rb|ag;
+        }
+    }
+}
+
+void QcNeedleSprites::blend(int first, int second, int weight) const
+{
+    // the sum of both sprites at their weights, drawing one over the other
+    // would show two needles instead of one between them
+    if(d->blendFirst==first && d->blendSecond==second && d->blendWeight==weight)
+        return;
+    QC_TRACE_SCOPE("blendSprites","cache");
+    QRect a(d->offsets[first],d->sprites[first].size());
+    QRect b(d->offsets[second],d->sprites[second].size());
+    QRect r = a.united(b);
+    if(d->blend.width()<r.width() || d->blend.height()<r.height()){
+        qint64 old = qcImageBytes(d->blend);
+        d->blend = QImage(qMax(d->blend.width(),r.width()),qMax(d->blend.height(),r.height()),
+                          QImage::Format_ARGB32_Premultiplied);
+        d->setCacheBytes(d->cacheBytes()-old+qcImageBytes(d->blend));
+    }
+    for(int y=0;y<r.height();y++)
+        memset(d->blend.scanLine(y),0,r.width()*4);
+    qcAddWeighted(d->blend,d->sprites[first],a.topLeft()-r.topLeft(),256-weight);
+    qcAddWeighted(d->blend,d->sprites[second],b.topLeft()-r.topLeft(),weight);
+    d->blendRect = r;
+    d->blendFirst = first;
+    d->blendSecond = second;
+    d->blendWeight = weight;
+}
+
+qint64 QcNeedleSprites::cacheBytes() const
+{
+    return d->cacheBytes();
+}
+
+void QcNeedleSprites::Cache::evict()
+{
+    // the slots stay, each sprite is drawn again when the needle gets there
+    QMutexLocker locker(&mutex);
+    for(int i=0;i<sprites.size();i++)
+        sprites[i] = QImage();
+    blend = QImage();
+    blendFirst = -1;
+    setCacheBytes(0);
+}
+
+void QcNeedleSprites::render(const QcNeedleState &state, int index) const
+{
+    QC_TRACE_SCOPE("renderSprite","cache");
+    float rotation = index*360.0/count+90.0;
+    QTransform transform;
+    transform.scale(d->ratio,d->ratio);
+    transform.rotate(rotation);
+    QRect bounds = transform.map(state.needlePoly).boundingRect().toAlignedRect().adjusted(-1,-1,1,1);
+
+    QImage sprite(bounds.size(),QImage::Format_ARGB32_Premultiplied);
+    sprite.fill(Qt::transparent);
+    QPainter painter(&sprite);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.translate(-bounds.topLeft());
+    painter.scale(d->ratio,d->ratio);
+    state.drawNeedle(&painter,rotation);
+    painter.end();
+
+    sprite.setDevicePixelRatio(d->ratio);
+    d->sprites[index] = sprite;
+    d->offsets[index] = bounds.topLeft();
+    d->setCacheBytes(d->cacheBytes()+qcImageBytes(sprite));
+}
+
+QcNeedleState::QcNeedleState()
+{
+    position = 50;
+    currentValue = 0;
+    color = Qt::black;
+    needleType = QcNeedleItem::FeatherNeedle;
+    quality = QcGaugeWidget::FullQuality;
+    polyRadius = 0;
+    polyType = -1;
+    brushGradient = false;
+}
+
+void QcNeedleState::draw(QPainter *painter, const QRectF &rect, const QcScale &scale)
+{
+    prepare(rect,scale,qcDeviceRatio(painter));
+    paint(painter,rect,scale);
+}
+
+void QcNeedleState::prepare(const QRectF &rect, const QcScale &, qreal)
+{
+    createNeedle(QcItem::radius(QcItem::adjustRect(rect,position)));
+    bool gradient = needleType==QcNeedleItem::CompassNeedle && quality<QcGaugeWidget::FlatFills;
+    if(brush.style()==Qt::NoBrush || brushColor!=color || brushGradient!=gradient){
+        if(gradient){
+            QLinearGradient grad;
+            grad.setStart(needlePoly[0]);
+            grad.setFinalStop(needlePoly[1]);
+            grad.setColorAt(0.9,Qt::red);
+            grad.setColorAt(1,Qt::blue);
+            brush = QBrush(grad);
+        }
+        else
+            brush = QBrush(color);
+        brushColor = color;
+        brushGradient = gradient;
+    }
+}
+
+void QcNeedleState::paint(QPainter *painter, const QRectF &rect, const QcScale &scale) const
+{
+    QRectF tmpRect = QcItem::adjustRect(rect,position);
+    float deg = scale.degFromValue( currentValue);
+    float r = QcItem::radius(tmpRect);
+    if(sprites.count>0){
+        sprites.draw(painter,*this,tmpRect.center(),r,deg);
+        return;
+    }
+    // save() would allocate a painter state on every frame
+    QTransform transform = painter->worldTransform();
+    QPen pen = painter->pen();
+    QBrush brush = painter->brush();
+    painter->translate(tmpRect.center());
+    drawNeedle(painter,deg+90.0);
+    painter->setWorldTransform(transform);
+    painter->setPen(pen);
+    painter->setBrush(brush);
+}
+
+void QcNeedleState::drawNeedle(QPainter *painter, float rotation) const
+{
+    painter->rotate(rotation);
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(brush);
+    painter->drawConvexPolygon(needlePoly);
+}
+
+void QcNeedleState::createNeedle(float r)
+{
+    if(polyRadius==r && polyType==needleType)
+        return;
+    QVector<QPointF> tmpPoints;
+    switch (needleType) {
+    case QcNeedleItem::DiamonNeedle:
+        tmpPoints.append(QPointF(0.0, 0.0));
+        tmpPoints.append(QPointF(-r/20.0,r/20.0));
+        tmpPoints.append(QPointF(0.0, r));
+        tmpPoints.append(QPointF(r/20.0,r/20.0));
+        break;
+    case QcNeedleItem::TriangleNeedle:
+        tmpPoints.append(QPointF(0.0, r));
+        tmpPoints.append(QPointF(-r/40.0, 0.0));
+        tmpPoints.append(QPointF(r/40.0,0.0));
+        break;
+    case QcNeedleItem::FeatherNeedle:
+        tmpPoints.append(QPointF(0.0, r));
+        tmpPoints.append(QPointF(-r/40.0, 0.0));
+        tmpPoints.append(QPointF(-r/15.0, -r/5.0));
+        tmpPoints.append(QPointF(r/15.0,-r/5));
+        tmpPoints.append(QPointF(r/40.0,0.0));
+        break;
+    case QcNeedleItem::AttitudeMeterNeedle:
+        tmpPoints.append(QPointF(0.0, r));
+        tmpPoints.append(QPointF(-r/20.0, 0.85*r));
+        tmpPoints.append(QPointF(r/20.0,0.85*r));
+        break;
+    case QcNeedleItem::CompassNeedle:
+        tmpPoints.append(QPointF(0.0, r));
+        tmpPoints.append(QPointF(-r/15.0, 0.0));
+        tmpPoints.append(QPointF(0.0, -r));
+        tmpPoints.append(QPointF(r/15.0,0.0));
+        break;
+    default:
+        break;
+    }
+    needlePoly = tmpPoints;
+    polyRadius = r;
+    polyType = needleType;
+    // the compass gradient follows the polygon
+    brush = QBrush();
+}
+
+static const char *glyphAtlasCharacters = "0123456789+-.,:% ";
+
+QcGlyphAtlas::QcGlyphAtlas(const QFont &font, const QColor &color, qreal ratio) :
+    QcCacheEntry(QcRenderStatistics::GlyphCache)
+{
+    QC_TRACE_SCOPE("buildGlyphAtlas","cache");
+    mFont = font;
+    mColor = color;
+    mRatio = ratio;
+    for(int i=0;i<128;i++)
+        mIndex[i] = -1;
+
+    QFontMetricsF metrics(font);
+    mHeight = metrics.height();
+    mPadding = qCeil(mHeight/4.0);  // room for glyphs outside their advance
+    int count = qstrlen(glyphAtlasCharacters);
+    float x = 0;
+    for(int i=0;i<count;i++){
+        Glyph g;
+        g.advance = metrics.width(QLatin1Char(glyphAtlasCharacters[i]));
+        float w = qCeil(g.advance+2*mPadding);
+        g.source = QRectF(x*ratio,0,w*ratio,mHeight*ratio);
+        x += w;
+        mIndex[int(glyphAtlasCharacters[i])] = mGlyphs.size();
+        mGlyphs.append(g);
+    }
+    render();
+}
+
+void QcGlyphAtlas::render()
+{
+    QFontMetricsF metrics(mFont);
+    float width = mGlyphs.isEmpty() ? 0 : mGlyphs.last().source.right();
+    mImage = QImage(qCeil(width),qCeil(mHeight*mRatio),QImage::Format_ARGB32_Premultiplied);
+    mImage.fill(Qt::transparent);
+    QPainter painter(&mImage);
+    painter.scale(mRatio,mRatio);
+    painter.setFont(mFont);
+    painter.setPen(QPen(mColor));
+    for(int i=0;i<mGlyphs.size();i++){
+        QPointF baseline(mGlyphs[i].source.x()/mRatio+mPadding,metrics.ascent());
+        painter.drawText(baseline,QString(QLatin1Char(glyphAtlasCharacters[i])));
+    }
+    painter.end();
+    setCacheBytes(qcImageBytes(mImage));
+}
+
+void QcGlyphAtlas::evict()
+{
+    // the metrics stay, labels holding the atlas keep laying text out
+    QMutexLocker locker(&mMutex);
+    mImage = QImage();
+    setCacheBytes(0);
+}
+
+// atlases are shared by all labels with the same font, size and color
+// and may be requested from render threads. The registry holds them
+// weakly: an atlas no label holds any more is deleted, and its entry is
+// dropped when the next atlas is made, so changing colors don't pile up
+static QHash<QString,QWeakPointer<QcGlyphAtlas> > qcGlyphAtlases;
+static QMutex qcGlyphAtlasMutex;
+
+QSharedPointer<QcGlyphAtlas> QcGlyphAtlas::atlas(const QFont &font, const QColor &color, qreal ratio)
+{
+    QMutexLocker locker(&qcGlyphAtlasMutex);
+    QString key = font.key()+QString::number(color.rgba())+QString::number(ratio);
+    QSharedPointer<QcGlyphAtlas> atlas = qcGlyphAtlases.value(key).toStrongRef();
+    if(atlas.isNull()){
+        QHash<QString,QWeakPointer<QcGlyphAtlas> >::iterator i = qcGlyphAtlases.begin();
+        while(i!=qcGlyphAtlases.end()){
+            if(i.value().isNull())
+                i = qcGlyphAtlases.erase(i);
+            else
+                ++i;
+        }
+        atlas = QSharedPointer<QcGlyphAtlas>(new QcGlyphAtlas(font,color,ratio));
+        qcGlyphAtlases.insert(key,atlas);
+    }
+    return atlas;
+}
+
+qint64 QcGlyphAtlas::cachedBytes()
+{
+    return QcCacheManager::usage(QcRenderStatistics::GlyphCache);
+}
+
+int QcGlyphAtlas::format(float value, int decimals, char *buffer, int size)
+{
+    // writes the value into buffer without QString or locale and returns the
+    // length, a negative decimals count keeps six significant digits like
+    // QString::number() and drops trailing zeros, but never switches to an
+    // exponent: 1e6 and above print in full, 1000000 rather than 1e+06
+    double v = value;
+    bool negative = v<0;
+    if(negative)
+        v = -v;
+    if(!(v<1e15)) // also catches nan
+        v = v>0 ? 1e15-1 : 0;
+
+    bool trim = decimals<0;
+    if(trim){
+        int digits = 1;
+        for(double d=10;d<=v;d*=10)
+            digits++;
+        decimals = qMax(0,6-digits);
+    }
+    if(decimals>9)
+        decimals = 9;
+    double scale = 1;
+    for(int i=0;i<decimals;i++)
+        scale *= 10;
+    while(decimals>0 && v*scale>=1e15){ // beyond double precision
+        decimals--;
+        scale /= 10;
+    }
+    quint64 n = quint64(v*scale+0.5);
+    if(n==0)
+        negative = false;
+
+    char tmp[32];
+    int length = 0;
+    do{
+        tmp[length++] = '0'+n%10;
+        n /= 10;
+        if(length==decimals)
+            tmp[length++] = '.';
+    }while(n>0 || length<=decimals+1);
+    if(trim && decimals>0){
+        int i = 0;
+        while(tmp[i]=='0')
+            i++;
+        if(tmp[i]=='.')
+            i++;
+        length -= i;
+        memmove(tmp,tmp+i,length);
+    }
+    if(negative)
+        tmp[length++] = '-';
+
+    int count = qMin(length,size);
+    for(int i=0;i<count;i++)
+        buffer[i] = tmp[length-1-i];
+    return count;
+}
+
+QImage QcGlyphAtlas::pixels() const
+{
+    // a reference to the image, it stays valid if the atlas is evicted
+    // while the text is drawn
+    QcGlyphAtlas *atlas = const_cast<QcGlyphAtlas*>(this);
+    QMutexLocker locker(&mMutex);
+    if(mImage.isNull()){
+        qcCountCache(QcRenderStatistics::GlyphCache,QcCacheRebuild);
+        atlas->render();
+    }
+    atlas->touch();
+    return mImage;
+}
+
+bool QcGlyphAtlas::matches(const QFont &font, const QColor &color, qreal ratio) const
+{
+    return mRatio==ratio && mColor==color && mFont==font;
+}
+
+int QcGlyphAtlas::glyph(ushort c) const
+{
+    return c<128 ? mIndex[c] : -1;
+}
+
+bool QcGlyphAtlas::contains(const QString &text) const
+{
+    for(int i=0;i<text.size();i++)
+        if(glyph(text[i].unicode())<0)
+            return false;
+    return true;
+}
+
+QSizeF QcGlyphAtlas::size(const char *text, int length) const
+{
+    float w = 0;
+    for(int i=0;i<length;i++){
+        int g = glyph(uchar(text[i]));
+        if(g>=0)
+            w += mGlyphs[g].advance;
+    }
+    return QSizeF(w,mHeight);
+}
+
+QSizeF QcGlyphAtlas::size(const QString &text) const
+{
+    float w = 0;
+    for(int i=0;i<text.size();i++){
+        int g = glyph(text[i].unicode());
+        if(g>=0)
+            w += mGlyphs[g].advance;
+    }
+    return QSizeF(w,mHeight);
+}
+
+void QcGlyphAtlas::draw(QPainter *painter, const QPointF &topLeft, const char *text, int length) const
+{
+    QImage image = pixels();
+    float x = topLeft.x();
+    for(int i=0;i<length;i++){
+        int g = glyph(uchar(text[i]));
+        if(g<0)
+            continue;
+        const Glyph &glyph = mGlyphs[g];
+        QRectF target(x-mPadding,topLeft.y(),glyph.source.width()/mRatio,mHeight);
+        painter->drawImage(target,image,glyph.source);
+        x += glyph.advance;
+    }
+}
+
+void QcGlyphAtlas::draw(QPainter *painter, const QPointF &topLeft, const QString &text) const
+{
+    QImage image = pixels();
+    float x = topLeft.x();
+    for(int i=0;i<text.size();i++){
+        int g = glyph(text[i].unicode());
+        if(g<0)
+            continue;
+        const Glyph &glyph = mGlyphs[g];
+        QRectF target(x-mPadding,topLeft.y(),glyph.source.width()/mRatio,mHeight);
+        painter->drawImage(target,image,glyph.source);
+        x += glyph.advance;
+    }
+}
+
+QcLabelState::QcLabelState()
+{
+    position = 50;
+    angle = 270;
+    text = "%";
+    color = Qt::black;
+    font = "Arial";
+    digitsLength = -1;
+    textFontSize = 0;
+}
+
+void QcLabelState::setValue(float value, int decimals)
+{
+    digitsLength = QcGlyphAtlas::format(value,decimals,digits,sizeof(digits));
+}
+
+QString QcLabelState::displayText() const
+{
+    if(digitsLength>=0)
+        return QString::fromLatin1(digits,digitsLength);
+    return text;
+}
+
+void QcLabelState::draw(QPainter *painter, const QRectF &rect)
+{
+    prepare(rect,qcDeviceRatio(painter));
+    paint(painter,rect);
+}
+
+void QcLabelState::prepare(const QRectF &rect, qreal ratio)
+{
+    float r = QcItem::radius(rect);
+    if(textFontFamily!=font || textFontSize!=float(r/10.0)){
+        textFont = QFont(font, r/10.0, QFont::Bold);
+        textFontFamily = font;
+        textFontSize = r/10.0;
+        staticText = QStaticText();
+    }
+
+    // numbers are blitted from the glyph atlas, other text is shaped
+    if(atlas.isNull() || !atlas->matches(textFont,color,ratio)){
+        qcCountCache(QcRenderStatistics::GlyphCache,atlas.isNull() ? QcCacheMiss : QcCacheRebuild);
+        atlas = QcGlyphAtlas::atlas(textFont,color,ratio);
+    }
+    else
+        qcCountCache(QcRenderStatistics::GlyphCache,QcCacheHit);
+    if(digitsLength>=0 || atlas->contains(text))
+        return;
+
+    if(staticText.text()!=text){
+        staticText.setTextFormat(Qt::PlainText);
+        staticText.setText(text);
+        staticText.prepare(QTransform(),textFont);
+    }
+    if(pen.color()!=color)
+        pen = QPen(color);
+}
+
+void QcLabelState::paint(QPainter *painter, const QRectF &rect) const
+{
+    QPointF txtCenter = QcItem::pointAt(angle,QcItem::adjustRect(rect,position));
+    if(digitsLength>=0 || atlas->contains(text)){
+        QSizeF sz = digitsLength>=0 ? atlas->size(digits,digitsLength) : atlas->size(text);
+        QPointF topLeft = txtCenter-QPointF(sz.width()/2,sz.height()/2);
+        if(digitsLength>=0)
+            atlas->draw(painter,topLeft,digits,digitsLength);
+        else
+            atlas->draw(painter,topLeft,text);
+        return;
+    }
+
+    painter->setFont(textFont);
+    painter->setPen(pen);
+    QSizeF sz = staticText.size();
+    painter->drawStaticText(txtCenter-QPointF(sz.width()/2,sz.height()/2),staticText);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// cell codes are the character index times two, plus one with a decimal point
+static const char *readoutCharacters = "0123456789- ";
+static const uchar readoutSegments[12] = {0x3F,0x06,0x5B,0x4F,0x66,0x6D,0x7D,0x07,0x7F,0x6F,0x40,0x00};
+enum {ReadoutGlyphs=24,ReadoutDash=20,ReadoutBlank=22};
+
+static QPolygonF readoutSegment(const QPointF &from, const QPointF &to, float t)
+{
+    float g = t*0.15;
+    QPolygonF poly;
+    if(from.y()==to.y()){
+        float x0 = from.x()+g, x1 = to.x()-g, y = from.y();
+        poly << QPointF(x0,y) << QPointF(x0+t/2,y-t/2) << QPointF(x1-t/2,y-t/2)
+             << QPointF(x1,y) << QPointF(x1-t/2,y+t/2) << QPointF(x0+t/2,y+t/2);
+    }
+    else{
+        float y0 = from.y()+g, y1 = to.y()-g, x = from.x();
+        poly << QPointF(x,y0) << QPointF(x+t/2,y0+t/2) << QPointF(x+t/2,y1-t/2)
+             << QPointF(x,y1) << QPointF(x-t/2,y1-t/2) << QPointF(x-t/2,y0+t/2);
+    }
+    return poly;
+}
+
+QcDigitalReadoutState::QcDigitalReadoutState()
+{
+    position = 0;
+    angle = 270;
+    digitHeight = 25;
+    digitCount = 6;
+    style = QcDigitalReadoutItem::SevenSegment;
+    color = Qt::black;
+    offColor = Qt::transparent;
+    d = QSharedPointer<Cache>(new Cache);
+    d->style = -1;
+    d->ratio = 0;
+    setValue(0);
+}
+
+void QcDigitalReadoutState::setValue(float value, int decimals)
+{
+    char text[32];
+    int length = QcGlyphAtlas::format(value,decimals,text,sizeof(text));
+    cells.fill(ReadoutBlank,digitCount);
+
+    int digits = 0;
+    for(int i=0;i<length;i++)
+        if(text[i]!='.')
+            digits++;
+    if(digits>digitCount){
+        cells.fill(ReadoutDash,digitCount);
+        return;
+    }
+
+    // right aligned, the decimal point goes into the cell before it
+    int cell = digitCount-digits;
+    for(int i=0;i<length;i++){
+        if(text[i]=='.'){
+            if(cell>0)
+                cells[cell-1] |= 1;
+            continue;
+        }
+        const char *c = strchr(readoutCharacters,text[i]);
+        cells[cell++] = c ? (c-readoutCharacters)*2 : ReadoutBlank;
+    }
+}
+
+QRectF QcDigitalReadoutState::readoutRect(const QRectF &rect) const
+{
+    float h = QcItem::radius(rect)*digitHeight/100.0;
+    QRectF box(0,0,h*0.6*digitCount,h);
+    box.moveCenter(QcItem::pointAt(angle,QcItem::adjustRect(rect,position)));
+    return box;
+}
+
+QRectF QcDigitalReadoutState::cellRect(const QRectF &rect, int cell) const
+{
+    QRectF box = readoutRect(rect);
+    float w = box.width()/digitCount;
+    return QRectF(box.x()+cell*w,box.y(),w,box.height());
+}
+
+void QcDigitalReadoutState::draw(QPainter *painter, const QRectF &rect)
+{
+    paint(painter,rect);
+}
+
+void QcDigitalReadoutState::prepare(const QRectF &, qreal)
+{
+    // the cells are in the shared cache, made under its lock when painted
+}
+
+void QcDigitalReadoutState::paint(QPainter *painter, const QRectF &rect) const
+{
+    QMutexLocker locker(&d->mutex);
+    d->touch();
+    QRectF box = readoutRect(rect);
+    if(digitCount<=0 || box.isEmpty())
+        return;
+
+    qreal ratio = qcDeviceRatio(painter);
+    QSize cell(qCeil(box.width()/digitCount*ratio),qCeil(box.height()*ratio));
+    if(d->glyphs.isEmpty() || d->glyphs[0].size()!=cell || d->style!=style
+            || d->color!=color || d->offColor!=offColor || d->ratio!=ratio){
+        d->style = style;
+        d->color = color;
+        d->offColor = offColor;
+        d->ratio = ratio;
+        qcCountCache(QcRenderStatistics::ReadoutCache,d->glyphs.isEmpty() ? QcCacheMiss : QcCacheRebuild);
+        renderGlyphs(cell);
+        d->frameCells.clear();
+    }
+    else
+        qcCountCache(QcRenderStatistics::ReadoutCache,QcCacheHit);
+    if(d->frameCells.size()!=digitCount){
+        d->frame = QImage(cell.width()*digitCount,cell.height(),QImage::Format_ARGB32_Premultiplied);
+        d->frameCells.fill(0xff,digitCount);
+        d->account();
+    }
+
+    // copy the changed cells into the readout image, row by row since
+    // cells and frame share the pixel format and a QPainter allocates
+    int rowBytes = cell.width()*4;
+    for(int i=0;i<digitCount;i++){
+        uchar code = i<cells.size() ? cells[i] : ReadoutBlank;
+        if(d->frameCells[i]==code)
+            continue;
+        const QImage &glyph = d->glyphs[code];
+        for(int y=0;y<cell.height();y++)
+            memcpy(d->frame.scanLine(y)+i*rowBytes,glyph.constScanLine(y),rowBytes);
+        d->frameCells[i] = code;
+    }
+    QImage frame = d->frame;
+    locker.unlock();
+
+    painter->drawImage(QRectF(box.topLeft(),QSizeF(frame.width()/ratio,frame.height()/ratio)),frame);
+}
+
+qint64 QcDigitalReadoutState::cacheBytes() const
+{
+    return d->cacheBytes();
+}
+
+void QcDigitalReadoutState::Cache::account()
+{
+    qint64 bytes = qcImageBytes(frame);
+    for(int i=0;i<glyphs.size();i++)
+        bytes += qcImageBytes(glyphs[i]);
+    setCacheBytes(bytes);
+}
+
+void QcDigitalReadoutState::Cache::evict()
+{
+    QMutexLocker locker(&mutex);
+    glyphs.clear();
+    frame = QImage();
+    frameCells.clear();
+    setCacheBytes(0);
+}
+
+void QcDigitalReadoutState::renderGlyphs(const QSize &size) const
+{
+    QC_TRACE_SCOPE("renderReadoutGlyphs","cache");
+    d->glyphs.resize(ReadoutGlyphs);
+    QSizeF cell(size.width()/d->ratio,size.height()/d->ratio);
+    for(int code=0;code<ReadoutGlyphs;code++){
+        QImage glyph(size,QImage::Format_ARGB32_Premultiplied);
+        glyph.fill(Qt::transparent);
+        QPainter painter(&glyph);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.scale(d->ratio,d->ratio);
+        renderGlyph(&painter,cell,code);
+        painter.end();
+        d->glyphs[code] = glyph;
+    }
+}
+
+void QcDigitalReadoutState::renderGlyph(QPainter *painter, const QSizeF &size, int code) const
+{
+    int index = code/2;
+    bool dot = code&1;
+    float w = size.width();
+    float h = size.height();
+    float t = w*0.14;
+    float left = w*0.06+t/2;
+    float right = w-2*t;
+    float top = h*0.04+t/2;
+    float bottom = h-h*0.04-t/2;
+    float middle = (top+bottom)/2;
+    bool drawOff = offColor.alpha()>0;
+    painter->setPen(Qt::NoPen);
+
+    if(style==QcDigitalReadoutItem::SevenSegment){
+        QPointF ends[7][2] = {
+            {QPointF(left,top),QPointF(right,top)},         // a
+            {QPointF(right,top),QPointF(right,middle)},     // b
+            {QPointF(right,middle),QPointF(right,bottom)},  // c
+            {QPointF(left,bottom),QPointF(right,bottom)},   // d
+            {QPointF(left,middle),QPointF(left,bottom)},    // e
+            {QPointF(left,top),QPointF(left,middle)},       // f
+            {QPointF(left,middle),QPointF(right,middle)}    // g
+        };
+        for(int i=0;i<7;i++){
+            bool on = readoutSegments[index]&(1<<i);
+            if(!on && !drawOff)
+                continue;
+            painter->setBrush(on ? color : offColor);
+            painter->drawConvexPolygon(readoutSegment(ends[i][0],ends[i][1],t));
+        }
+    }
+    else{
+        QFont font;
+        font.setPixelSize(qMax(1,qRound(h*0.9)));
+        painter->setFont(font);
+        painter->setPen(QPen(color));
+        painter->drawText(QRectF(0,0,right+t/2,h),Qt::AlignCenter,QString(QLatin1Char(readoutCharacters[index])));
+        painter->setPen(Qt::NoPen);
+        drawOff = false;
+    }
+
+    if(dot || drawOff){
+        painter->setBrush(dot ? color : offColor);
+        painter->drawEllipse(QPointF(right+t*1.3,bottom),t*0.6,t*0.6);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcScaleItem::QcScaleItem(QObject *parent) :
+    QcItem(parent)
+{
+}
+
+QcScale *QcScaleItem::ownScale()
+{
+    if(mScale.isNull()){
+        mScale = QSharedPointer<QcScale>(new QcScale);
+        connect(mScale.data(),&QcScale::changed,this,&QcScaleItem::scaleChanged);
+    }
+    return mScale.data();
+}
+
+const QcScale &QcScaleItem::currentScale() const
+{
+    static const QcScale defaults;
+    return mScale.isNull() ? defaults : *mScale;
+}
+
+QSharedPointer<QcScale> QcScaleItem::scaleCopy()
+{
+    // a frozen copy shared by the snapshots, made again once the scale's
+    // revision moves on; one still being drawn keeps its copy alive
+    const QcScale &scale = currentScale();
+    if(mScaleCopy.isNull() || mScaleCopy->revision()!=scale.revision()){
+        mScaleCopy = QSharedPointer<QcScale>(new QcScale);
+        mScaleCopy->copyFrom(scale);
+    }
+    return mScaleCopy;
+}
+
+void QcScaleItem::setValueRange(float minValue, float maxValue)
+{
+    ownScale()->setValueRange(minValue,maxValue);
+}
+
+void QcScaleItem::setDegreeRange(float minDegree, float maxDegree)
+{
+    ownScale()->setDegreeRange(minDegree,maxDegree);
+}
+
+void QcScaleItem::setMinValue(float minValue)
+{
+    ownScale()->setMinValue(minValue);
+}
+
+void QcScaleItem::setMaxValue(float maxValue)
+{
+    ownScale()->setMaxValue(maxValue);
+}
+
+void QcScaleItem::setMinDegree(float minDegree)
+{
+    ownScale()->setMinDegree(minDegree);
+}
+
+void QcScaleItem::setMaxDegree(float maxDegree)
+{
+    ownScale()->setMaxDegree(maxDegree);
+}
+
+void QcScaleItem::setDegreeOffset(float degreeOffset)
+{
+    ownScale()->setDegreeOffset(degreeOffset);
+}
+
+void QcScaleItem::setMapping(const QSharedPointer<QcScaleMapping> &mapping)
+{
+    ownScale()->setMapping(mapping);
+}
+
+QSharedPointer<QcScaleMapping> QcScaleItem::mapping()
+{
+    return currentScale().mapping();
+}
+
+void QcScaleItem::setScale(const QSharedPointer<QcScale> &scale)
+{
+    if(scale.isNull() || scale==mScale)
+        return;
+    if(!mScale.isNull())
+        disconnect(mScale.data(),&QcScale::changed,this,&QcScaleItem::scaleChanged);
+    mScale = scale;
+    connect(mScale.data(),&QcScale::changed,this,&QcScaleItem::scaleChanged);
+    update();
+}
+
+QSharedPointer<QcScale> QcScaleItem::scale()
+{
+    ownScale();
+    return mScale;
+}
+
+float QcScaleItem::minValue() const
+{
+    return currentScale().minValue();
+}
+
+float QcScaleItem::maxValue() const
+{
+    return currentScale().maxValue();
+}
+
+float QcScaleItem::minDegree() const
+{
+    return currentScale().minDegree();
+}
+
+float QcScaleItem::maxDegree() const
+{
+    return currentScale().maxDegree();
+}
+
+float QcScaleItem::degreeOffset() const
+{
+    return currentScale().degreeOffset();
+}
+
+void QcScaleItem::scaleChanged()
+{
+    // caches built from the scale compare against its revision when drawn
+    update();
+}
+
+float QcScaleItem::getDegFromValue(float v) const
+{
+    return currentScale().degFromValue(v);
+}
+
+float QcScaleItem::getDegFromValue()
+{
+    return currentScale().degFromValue(currentScale().minValue());
+}
+
+void QcScaleItem::getDegFromValues(const float *values, float *degrees, int count) const
+{
+    currentScale().degFromValues(values,degrees,count);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcBackgroundItem::QcBackgroundItem(QObject *parent) :
+    QcItem(parent)
+{
+    setPosition(88);
+}
+
+
+void QcBackgroundItem::draw(QPainter* painter)
+{
+    mState.position = position();
+    mState.quality = quality();
+    mState.draw(painter,resetRect());
+}
+
+void QcBackgroundItem::addColor(float position, const QColor &color)
+{
+    if(position<0||position>1)
+        return;
+      QPair<float,QColor> pair;
+      pair.first = position;
+      pair.second = color;
+      mState.colors.append(pair);
+      invalidateCache();
+}
+
+void QcBackgroundItem::clearrColors()
+{
+    mState.colors.clear();
+    invalidateCache();
+}
+
+bool QcBackgroundItem::isStatic()
+{
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcGlassItem::QcGlassItem(QObject *parent) :
+    QcItem(parent)
+{
+    setPosition(88);
+}
+
+void QcGlassItem::draw(QPainter *painter)
+{
+    mState.position = position();
+    mState.quality = quality();
+    mState.draw(painter,resetRect());
+}
+
+bool QcGlassItem::isStatic()
+{
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcLabelItem::QcLabelItem(QObject *parent) :
+    QcItem(parent)
+{
+    setPosition(50);
+}
+
+void QcLabelItem::draw(QPainter *painter)
+{
+    mState.position = position();
+    mState.draw(painter,resetRect());
+}
+
+QcItemSnapshot *QcLabelItem::snapshot()
+{
+    mState.position = position();
+    return new QcStateSnapshot<QcLabelState>(mState);
+}
+
+void QcLabelItem::setAngle(float a)
+{
+    mState.angle = a;
+    update();
+}
+
+float QcLabelItem::angle()
+{
+    return mState.angle;
+}
+
+void QcLabelItem::setText(const QString &text, bool repaint)
+{
+    mState.text = text;
+    mState.digitsLength = -1;
+    if(repaint)
+        update();
+}
+
+void QcLabelItem::setValue(float value, int decimals, bool repaint)
+{
+    mState.setValue(value,decimals);
+    if(repaint)
+        update();
+}
+
+QString QcLabelItem::text()
+{
+    return mState.displayText();
+}
+
+void QcLabelItem::setColor(const QColor &color)
+{
+    mState.color = color;
+    update();
+}
+
+QColor QcLabelItem::color()
+{
+    return mState.color;
+}
+
+void QcLabelItem::setFont(const QString &font) {
+    mState.font = font;
+}
+
+QString QcLabelItem::font() {
+    return mState.font;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcArcItem::QcArcItem(QObject *parent) :
+    QcScaleItem(parent)
+{
+    setPosition(80);
+}
+
+void QcArcItem::draw(QPainter *painter)
+{
+    mState.position = position();
+    mState.draw(painter,resetRect(),currentScale());
+}
+
+QcItemSnapshot *QcArcItem::snapshot()
+{
+    mState.position = position();
+    return new QcScaleStateSnapshot<QcArcState>(mState,scaleCopy());
+}
+
+void QcArcItem::setColor(const QColor &color)
+{
+    mState.color = color;
+}
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcColorBand::QcColorBand(QObject *parent) :
+    QcScaleItem(parent)
+{
+    setPosition(50);
+}
+
+void QcColorBand::draw(QPainter *painter)
+{
+    mState.position = position();
+    mState.draw(painter,resetRect(),currentScale());
+}
+
+QcItemSnapshot *QcColorBand::snapshot()
+{
+    mState.position = position();
+    return new QcScaleStateSnapshot<QcColorBandState>(mState,scaleCopy());
+}
+
+qint64 QcColorBand::cacheBytes()
+{
+    return mState.cacheBytes();
+}
+
+void QcColorBand::setColors(const QList<QPair<QColor, float> > &colors)
+{
+    mState.colors = colors;
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcDegreesItem::QcDegreesItem(QObject *parent) :
+    QcScaleItem(parent)
+{
+    setPosition(90);
+}
+
+
+void QcDegreesItem::draw(QPainter *painter)
+{
+    mState.position = position();
+    mState.quality = quality();
+    mState.draw(painter,resetRect(),currentScale());
+}
+
+QcItemSnapshot *QcDegreesItem::snapshot()
+{
+    mState.position = position();
+    mState.quality = quality();
+    return new QcScaleStateSnapshot<QcDegreesState>(mState,scaleCopy());
+}
+
+void QcDegreesItem::setStep(float step)
+{
+    mState.ticks.setStep(step);
+    update();
+}
+
+void QcDegreesItem::setAutoSpacing(float minSpacing)
+{
+    mState.ticks.setAutoSpacing(minSpacing);
+    update();
+}
+
+void QcDegreesItem::setColor(const QColor& color)
+{
+    mState.color = color;
+    update();
+}
+
+void QcDegreesItem::setSubDegree(bool b)
+{
+    mState.subDegree = b;
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcNeedleItem::QcNeedleItem(QObject *parent) :
+    QcScaleItem(parent)
+{
+    mLabel = NULL;
+    mLabelDeferred = false;
+    mLabelStale = false;
+}
+
+void QcNeedleItem::draw(QPainter *painter)
+{
+    mState.position = position();
+    mState.quality = quality();
+    mState.draw(painter,resetRect(),currentScale());
+}
+
+QcItemSnapshot *QcNeedleItem::snapshot()
+{
+    mState.position = position();
+    mState.quality = quality();
+    return new QcScaleStateSnapshot<QcNeedleState>(mState,scaleCopy());
+}
+
+void QcNeedleItem::setCurrentValue(float value)
+{
+    if(!qIsFinite(value))
+        return;
+       if(value<minValue())
+        value = minValue();
+    else if(value>maxValue())
+        value = maxValue();
+    // a label linked since the last value still needs this one
+    if(value==mState.currentValue && !mLabelStale){
+        dropValue();
+        return;
+    }
+    mState.currentValue = value;
+
+    if(mLabel!=0){
+        mLabelStale = false;
+        if(!deferChanges())
+            mLabel->setValue(mState.currentValue,-1,false);
+        else if(!mLabelDeferred){
+            mLabelDeferred = true;
+            defer();
+        }
+    }
+
+/// This pull request is not working properly
+//    if(mLabel!=0){
+//        QString currentValue;
+//        mLabel->setText( currentValue ,false);
+//        mLabel->setText(currentValue.sprintf(mFormat.toStdString().c_str(), mCurrentValue),false);
+//        Q_UNUSED(currentValue);
+//    }
+    update();
+}
+
+float QcNeedleItem::currentValue()
+{
+    return mState.currentValue;
+}
+
+void QcNeedleItem::setValueFormat(QString format){
+    mFormat = format;
+    update();
+}
+
+QString QcNeedleItem::currentValueFormat(){
+    return mFormat;
+}
+
+void QcNeedleItem::setColor(const QColor &color)
+{
+    mState.color = color;
+    update();
+}
+
+QColor QcNeedleItem::color()
+{
+    return mState.color;
+}
+
+void QcNeedleItem::setLabel(QcLabelItem *label)
+{
+    mLabel = label;
+    mLabelStale = label!=0;
+    update();
+}
+
+QcLabelItem *QcNeedleItem::label()
+{
+    return mLabel;
+}
+
+void QcNeedleItem::setChannelValue(int, float value)
+{
+    setCurrentValue(value);
+}
+
+void QcNeedleItem::applyDeferred()
+{
+    if(mLabelDeferred && mLabel!=0)
+        mLabel->setValue(mState.currentValue,-1,false);
+    mLabelDeferred = false;
+}
+
+qint64 QcNeedleItem::cacheBytes()
+{
+    return mState.sprites.cacheBytes();
+}
+
+
+void QcNeedleItem::setNeedle(QcNeedleItem::NeedleType needleType)
+{
+    mState.needleType = needleType;
+    update();
+}
+
+void QcNeedleItem::setSpriteCount(int count)
+{
+    // e.g. 720 sprites for half degree steps, 0 draws the needle directly
+    if(count<0)
+        count = 0;
+    else if(count>MaxSprites)
+        count = MaxSprites;
+    mState.sprites.count = count;
+    update();
+}
+
+int QcNeedleItem::spriteCount()
+{
+    return mState.sprites.count;
+}
+
+void QcNeedleItem::setSpriteBlending(bool blending)
+{
+    mState.sprites.blending = blending;
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcValuesItem::QcValuesItem(QObject *parent) :
+    QcScaleItem(parent)
+{
+    setPosition(70);
+}
+
+
+void QcValuesItem::draw(QPainter*painter)
+{
+    mState.position = position();
+    mState.draw(painter,resetRect(),currentScale());
+}
+
+QcItemSnapshot *QcValuesItem::snapshot()
+{
+    mState.position = position();
+    return new QcScaleStateSnapshot<QcValuesState>(mState,scaleCopy());
+}
+
+void QcValuesItem::setStep(float step)
+{
+    mState.ticks.setStep(step);
+}
+
+float QcValuesItem::step() {
+    return mState.ticks.step();
+}
+
+void QcValuesItem::setAutoSpacing(float minSpacing)
+{
+    mState.ticks.setAutoSpacing(minSpacing);
+}
+
+void QcValuesItem::setColor(const QColor& color)
+{
+    mState.color = color;
+}
+
+QColor QcValuesItem::color() {
+    return mState.color;
+}
+
+void QcValuesItem::setFont(const QString& font)
+{
+    mState.font = font;
+}
+
+QString QcValuesItem::font() {
+    return mState.font;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+QcAttitudeMeter::QcAttitudeMeter(QObject *parent) : QcItem(parent)
+{
+    mPitch = 0;
+    mRoll = 0;
+}
+void QcAttitudeMeter::setCurrentPitch(float pitch)
+{
+    mPitch=-pitch;
+    update();
+}
+void QcAttitudeMeter::setCurrentRoll(float roll)
+{
+    mRoll = roll;
+    update();
+}
+QPointF QcAttitudeMeter::getIntersection(float r, const QPointF &pitchPoint, const QPointF &pt)
+{
+    // refrence it to zero
+
+    Q_UNUSED(r)
+    float a = (pitchPoint.y()-pt.y())/(pitchPoint.x()-pt.x());
+    float b = pt.y()-a*pt.x();
+    return QPointF(0,a*0+b);
+}
+float QcAttitudeMeter::getStartAngle(const QRectF& tmpRect)
+{
+    float r = getRadius(tmpRect);
+    QPointF pt1 = getPoint(mRoll,tmpRect);
+    pt1.setY(pt1.y()-mPitchOffset);
+    QPointF pitchPoint = QPointF(tmpRect.center().x(),tmpRect.center().y()-mPitchOffset);
+
+
+    ///////////////////////////////////////
+    QPainterPath path1;
+    path1.moveTo(pitchPoint);
+    path1.lineTo(getIntersection(r,pitchPoint,pt1)+QPointF(0,5));
+    path1.lineTo(getIntersection(r,pitchPoint,pt1)+QPointF(0,-5));
+
+    QPainterPath path2;
+    path2.addEllipse(tmpRect);
+
+    QPointF p = path1.intersected(path2).pointAtPercent(.5);
+    return getAngle(p,tmpRect);
+}
+void QcAttitudeMeter::draw(QPainter *painter)
+{
+    resetRect();
+    QRectF tmpRect = adjustRect(position());
+    float r = getRadius(tmpRect);
+    if(mPitch<0)
+        mPitchOffset = 0.0135*r*mPitch;
+    else
+        mPitchOffset = 0.015*r*mPitch;
+
+    painter->setPen(Qt::NoPen);
+    drawUpperEllipse(painter,tmpRect);
+    drawLowerEllipse(painter,tmpRect);
+
+    // Steps
+
+    drawPitchSteps(painter,tmpRect);
+    drawHandle(painter);
+
+    drawDegrees(painter);
+
+}
+void QcAttitudeMeter::drawDegrees(QPainter *painter)
+{
+    resetRect();
+    QRectF tmpRect = adjustRect(position());
+    float r = getRadius(tmpRect);
+    QPen pen;
+
+    pen.setColor(Qt::white);
+    painter->setPen(pen);
+    for(int deg = 60;deg<=120;deg+=10){
+        if(deg == 90)
+            continue;
+        drawDegree(painter,tmpRect,deg);
+    }
+
+    pen.setWidthF(r/30.0);
+    painter->setPen(pen);
+    drawDegree(painter,tmpRect,0);
+    drawDegree(painter,tmpRect,90);
+    drawDegree(painter,tmpRect,180);
+    drawDegree(painter,tmpRect,30);
+    drawDegree(painter,tmpRect,150);
+}
+void QcAttitudeMeter::drawDegree(QPainter * painter, const QRectF& tmpRect,float deg)
+{
+    QPointF pt1 = getPoint(deg,tmpRect);
+    QPointF pt2 = tmpRect.center();
+    QPainterPath path;
+    path.moveTo(pt1);
+    path.lineTo(pt2);
+    QPointF pt = path.pointAtPercent(0.1);
+    painter->drawLine(pt1,pt);
+}
+void QcAttitudeMeter::drawUpperEllipse(QPainter *painter, const QRectF &tmpRect)
+{
+
+    QLinearGradient radialGrad1(tmpRect.topLeft(),tmpRect.bottomRight());
+    QColor clr1 = Qt::blue;
+    clr1.setAlphaF(0.5);
+    QColor clr2 = Qt::darkBlue;
+    clr2.setAlphaF(0.5);
+    radialGrad1.setColorAt(0, clr1);
+    radialGrad1.setColorAt(.8, clr2);
+
+
+    float offset = getStartAngle(tmpRect);
+    float startAngle = 180-offset;
+    float endAngle = offset-2*mRoll;
+    float span =endAngle-startAngle;
+
+    painter->setBrush(radialGrad1);
+    painter->drawChord(tmpRect,16*startAngle,16*span);
+
+}
+void QcAttitudeMeter::drawLowerEllipse(QPainter *painter, const QRectF &tmpRect)
+{
+    QLinearGradient radialGrad2(tmpRect.topLeft(),tmpRect.bottomRight());
+    QColor clr1 = QColor(139,119,118);
+    QColor clr2 = QColor(139,119,101);
+    radialGrad2.setColorAt(0, clr1);
+    radialGrad2.setColorAt(.8, clr2);
+
+    float offset = getStartAngle(tmpRect);
+    float startAngle = 180+offset;
+    float endAngle = offset-2*mRoll;
+    float span =endAngle+startAngle;
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(radialGrad2);
+    painter->drawChord(tmpRect,-16*startAngle,16*span);
+
+}
+void QcAttitudeMeter::drawPitchSteps(QPainter *painter, const QRectF &tmpRect)
+{
+    float r = getRadius(tmpRect);
+    QPointF center = tmpRect.center();
+    painter->save();
+    painter->translate(center.x(),center.y()-mPitchOffset);
+    painter->rotate(mRoll);
+    QPen pen;
+    pen.setColor(Qt::white);
+    pen.setWidthF(r/40.0);
+
+    painter->setPen(pen);
+    for (int i = -30;i<=30;i+=10){
+        QPointF pt1;
+        pt1.setX(-0.01*r*abs(i));
+        pt1.setY(r/70.0*i);
+        QPointF pt2;
+        pt2.setX(0.01*r*abs(i));
+        pt2.setY(r/70.0*i);
+        painter->drawLine(pt1,pt2);
+
+        if(i==0)
+            continue;
+
+        // draw value
+        QFont font("Meiryo UI",0, QFont::Bold);
+        font.setPointSizeF(0.08*r);
+        painter->setFont(font);
+        QString strVal = QString::number(abs(i));
+        QFontMetrics fMetrics = painter->fontMetrics();
+        QSize sz = fMetrics.size( Qt::TextSingleLine, strVal );
+        QRectF leftTxtRect(QPointF(0,0), sz );
+        QRectF rightTxtRect(QPointF(0,0), sz );
+        leftTxtRect.moveCenter(pt1-QPointF(0.1*r,0));
+        rightTxtRect.moveCenter(pt2+QPointF(0.1*r,0));
+        painter->drawText( leftTxtRect, Qt::TextSingleLine, strVal );
+        painter->drawText( rightTxtRect, Qt::TextSingleLine, strVal );
+    }
+    painter->restore();
+}
+void QcAttitudeMeter::drawHandle(QPainter *painter)
+{
+    QRectF tmpRct = adjustRect(15);
+    float r = getRadius(tmpRct);
+    QPen pen;
+    pen.setColor(Qt::gray);
+    pen.setWidthF(0.25*r);
+    painter->setPen(pen);
+    painter->drawArc(tmpRct,0,-16*180);
+
+    QPointF center = tmpRct.center();
+    QPointF leftPt1 = center;
+    QPointF leftPt2 = center;
+    QPointF rightPt1 = center;
+    QPointF rightPt2 = center;
+    leftPt1.setX(center.x()-2*r);
+    leftPt2.setX(center.x()-r);
+    rightPt1.setX(center.x()+2*r);
+    rightPt2.setX(center.x()+r);
+    painter->drawLine(leftPt1,leftPt2);
+    painter->drawLine(rightPt1,rightPt2);
+    painter->drawEllipse(adjustRect(2));
+
+    //
+    QPointF pt1 = center;
+    QPointF pt2 = center;
+    // to get the real 100 % radius, without recomputing
+    pt1.setY(center.y()+r);
+    pt2.setY(center.y()+4*r);
+    pen.setColor(Qt::gray);
+    painter->setPen(pen);
+    painter->drawLine(pt1,pt2);
+
+    // trapezium
+    painter->setPen(Qt::gray);
+    painter->setBrush(Qt::gray);
+    QPolygonF trapPoly;
+    QPointF tmpPt = center;
+    tmpPt.setX(center.x()-r);
+    tmpPt.setY(center.y()+4*r);
+    trapPoly.append(tmpPt);
+    tmpRct = adjustRect(position());
+    trapPoly.append(getPoint(290,tmpRct));
+    trapPoly.append(getPoint(250,tmpRct));
+    tmpPt = center;
+    tmpPt.setX(center.x()+r);
+    tmpPt.setY(center.y()+4*r);
+    trapPoly.append(tmpPt);
+    painter->drawPolygon(trapPoly);
+    painter->drawChord(tmpRct,-16*70,-16*40);
+}
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-QcBackgroundItem::QcBackgroundItem(QObject *parent) :
+QcDigitalReadoutItem::QcDigitalReadoutItem(QObject *parent) :
     QcItem(parent)
 {
-    setPosition(88);
-    mPen = Qt::NoPen;
-    setPosition(88);
-
-    addColor(0.4,Qt::darkGray);
-    addColor(0.8,Qt::black);
-
+    mValue = 0;
+    mDecimals = -1;
+    mCellsDeferred = false;
+    setPosition(0);
 }
 
-
-void QcBackgroundItem::draw(QPainter* painter)
+void QcDigitalReadoutItem::draw(QPainter *painter)
 {
-    QRectF tmpRect = resetRect();
-    painter->setBrush(Qt::NoBrush);
-    QLinearGradient linearGrad(tmpRect.topLeft(), tmpRect.bottomRight());
-    for(int i = 0;i<mColors.size();i++){
-        linearGrad.setColorAt(mColors[i].first,mColors[i].second);
-    }
-    painter->setPen(mPen);
-    painter->setBrush(linearGrad);
-    painter->drawEllipse(adjustRect(position()));
+    mState.position = position();
+    mState.draw(painter,resetRect());
 }
 
-void QcBackgroundItem::addColor(float position, const QColor &color)
+QcItemSnapshot *QcDigitalReadoutItem::snapshot()
 {
-    if(position<0||position>1)
-        return;
-      QPair<float,QColor> pair;
-      pair.first = position;
-      pair.second = color;
-      mColors.append(pair);
-      update();
+    mState.position = position();
+    return new QcStateSnapshot<QcDigitalReadoutState>(mState);
 }
 
-void QcBackgroundItem::clearrColors()
+void QcDigitalReadoutItem::setValue(float value, int decimals)
 {
-    mColors.clear();
-}
+    if(value==mValue && decimals==mDecimals && !mState.cells.isEmpty()){
+        dropValue();
+        return;
+    }
+    mValue = value;
+    mDecimals = decimals;
+    if(deferChanges()){
+        if(!mCellsDeferred){
+            mCellsDeferred = true;
+            defer();
+        }
+        update();
+        return;
+    }
 
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
+    uchar old[MaxDigits];
+    int oldCount = mState.cells.size();
+    memcpy(old,mState.cells.constData(),oldCount);
+    mState.setValue(value,decimals);
+    if(rect().isNull() || oldCount!=mState.cells.size()){
+        update();
+        return;
+    }
 
-QcGlassItem::QcGlassItem(QObject *parent) :
-    QcItem(parent)
-{
-    setPosition(88);
+    // repaint only the digits that changed
+    QRectF changed;
+    for(int i=0;i<oldCount;i++)
+        if(old[i]!=mState.cells[i])
+            changed |= mState.cellRect(rect(),i);
+    if(!changed.isNull())
+        update(changed.adjusted(-1,-1,1,1));
 }
 
-void QcGlassItem::draw(QPainter *painter)
+float QcDigitalReadoutItem::value()
 {
-    resetRect();
-    QRectF tmpRect1 = adjustRect(position());
-    QRectF tmpRect2 = tmpRect1;
-    float r = getRadius(tmpRect1);
-    tmpRect2.setHeight(r/2.0);
-    painter->setPen(Qt::NoPen);
-
-    QColor clr1 = Qt::gray ;
-    QColor clr2 = Qt::white;
-    clr1.setAlphaF(0.2);
-    clr2.setAlphaF(0.4);
-
-    QLinearGradient linearGrad1(tmpRect1.topLeft(), tmpRect1.bottomRight());
-    linearGrad1.setColorAt(0.1, clr1);
-    linearGrad1.setColorAt(0.5, clr2);
-
-    painter->setBrush(linearGrad1);
-    painter->drawPie(tmpRect1,0,16*180);
-    tmpRect2.moveCenter(rect().center());
-    painter->drawPie(tmpRect2,0,-16*180);
+    return mValue;
 }
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
 
-QcLabelItem::QcLabelItem(QObject *parent) :
-    QcItem(parent)
+void QcDigitalReadoutItem::setChannelValue(int, float value)
 {
-    setPosition(50);
-    mAngle = 270;
-    mText = "%";
-    mColor = Qt::black;
-    mFont = "Arial";
+    setValue(value,mDecimals);
 }
 
-void QcLabelItem::draw(QPainter *painter)
+void QcDigitalReadoutItem::applyDeferred()
 {
-    resetRect();
-    QRectF tmpRect = adjustRect(position());
-    float r = getRadius(rect());
-    QFont font(mFont, r/10.0, QFont::Bold);
-    painter->setFont(font);
-    painter->setPen(QPen(mColor));
-
-    QPointF txtCenter = getPoint(mAngle,tmpRect);
-    QFontMetrics fMetrics = painter->fontMetrics();
-    QSize sz = fMetrics.size( Qt::TextSingleLine, mText );
-    QRectF txtRect(QPointF(0,0), sz );
-    txtRect.moveCenter(txtCenter);
-
-    painter->drawText( txtRect, Qt::TextSingleLine,mText );
+    if(mCellsDeferred)
+        mState.setValue(mValue,mDecimals);
+    mCellsDeferred = false;
+}
 
+qint64 QcDigitalReadoutItem::cacheBytes()
+{
+    return mState.cacheBytes();
 }
 
-void QcLabelItem::setAngle(float a)
+void QcDigitalReadoutItem::setDigitCount(int count)
 {
-    mAngle = a;
+    if(count<1)
+        count = 1;
+    else if(count>MaxDigits)
+        count = MaxDigits;
+    mState.digitCount = count;
+    mState.setValue(mValue,mDecimals);
     update();
 }
 
-float QcLabelItem::angle()
+int QcDigitalReadoutItem::digitCount()
 {
-    return mAngle;
+    return mState.digitCount;
 }
 
-void QcLabelItem::setText(const QString &text, bool repaint)
+void QcDigitalReadoutItem::setDigitHeight(float percentage)
 {
-    mText = text;
-    if(repaint)
-        update();
+    mState.digitHeight = percentage;
+    update();
 }
 
-QString QcLabelItem::text()
+void QcDigitalReadoutItem::setAngle(float angle)
 {
-    return mText;
+    mState.angle = angle;
+    update();
 }
 
-void QcLabelItem::setColor(const QColor &color)
+void QcDigitalReadoutItem::setStyle(QcDigitalReadoutItem::Style style)
 {
-    mColor = color;
+    mState.style = style;
     update();
 }
 
-QColor QcLabelItem::color()
+void QcDigitalReadoutItem::setColor(const QColor &color)
 {
-    return mColor;
+    mState.color = color;
+    update();
 }
 
-void QcLabelItem::setFont(const QString &font) {
-    mFont = font;
+QColor QcDigitalReadoutItem::color()
+{
+    return mState.color;
 }
 
-QString QcLabelItem::font() {
-    return mFont;
+void QcDigitalReadoutItem::setOffColor(const QColor &color)
+{
+    mState.offColor = color;
+    update();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-QcArcItem::QcArcItem(QObject *parent) :
-    QcScaleItem(parent)
+QcLiteLayer::QcLiteLayer(QObject *parent) :
+    QcItem(parent)
 {
-    setPosition(80);
-    mColor = Qt::black;
+    mLabelsDeferred = false;
 }
 
-void QcArcItem::draw(QPainter *painter)
+// plain copies of the layer's vectors, no QObject is made per frame
+class QcLiteLayerSnapshot : public QcItemSnapshot
 {
-    resetRect();
-    QRectF tmpRect= adjustRect(position());
-    float r = getRadius(tmpRect);
+public:
+    void prepare(const QRectF &rect, qreal ratio)
+    {
+        QcLiteLayer::prepareEntries(rect,ratio,entries,scales,arcs,degrees,values,needles,labels);
+    }
+    void draw(QPainter *painter, const QRectF &rect)
+    {
+        QcLiteLayer::drawEntries(painter,rect,entries,scales,arcs,degrees,values,needles,labels);
+    }
 
-    QPen pen;
-    pen.setColor(mColor);
-    pen.setWidthF(r/40);
-    painter->setPen(pen);
-    painter->drawArc(tmpRect,-16*(mMinDegree+180),-16*(mMaxDegree-mMinDegree));
-}
+    QVector<QcLiteLayer::Entry> entries;
+    QVector<QSharedPointer<QcScale> > scales;
+    QVector<QcArcState> arcs;
+    QVector<QcDegreesState> degrees;
+    QVector<QcValuesState> values;
+    QVector<QcNeedleState> needles;
+    QVector<QcLabelState> labels;
+};
 
-void QcArcItem::setColor(const QColor &color)
+void QcLiteLayer::draw(QPainter *painter)
 {
-    mColor = color;
+    prepareEntries(resetRect(),qcDeviceRatio(painter),mEntries,mScales,mArcs,mDegrees,mValues,mNeedles,mLabels);
+    drawEntries(painter,resetRect(),mEntries,mScales,mArcs,mDegrees,mValues,mNeedles,mLabels);
 }
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
 
-QcColorBand::QcColorBand(QObject *parent) :
-    QcScaleItem(parent)
+void QcLiteLayer::setQuality(int quality)
 {
-    QColor tmpColor;
-    tmpColor.setAlphaF(0.1);
-    QPair<QColor,float> pair;
-
-    pair.first = Qt::green;
-    pair.second = 10;
-    mBandColors.append(pair);
-
-    pair.first = Qt::darkGreen;
-    pair.second = 50;
-    mBandColors.append(pair);
-
-    pair.first = Qt::red;
-    pair.second = 100;
-    mBandColors.append(pair);
-
-    setPosition(50);
+    QcItem::setQuality(quality);
+    for(int i=0;i<mDegrees.size();i++)
+        mDegrees[i].quality = quality;
+    for(int i=0;i<mNeedles.size();i++)
+        mNeedles[i].quality = quality;
 }
 
-QPainterPath QcColorBand::createSubBand(float from, float sweep)
+QcItemSnapshot *QcLiteLayer::snapshot()
 {
-    QRectF tmpRect = adjustRect(position());
-    QPainterPath path;
-    path.arcMoveTo(tmpRect,180+from);
-    path.arcTo(tmpRect,180+from,-sweep);
-    return path;
+    // a scale copy is shared by the snapshots until the scale changes;
+    // one still being drawn keeps its copy alive
+    if(mScaleCopies.size()!=mScales.size()){
+        mScaleCopies.resize(0);
+        for(int i=0;i<mScales.size();i++){
+            QSharedPointer<QcScale> scale(new QcScale);
+            scale->copyFrom(*mScales[i]);
+            mScaleCopies.append(scale);
+        }
+    }
+    QcLiteLayerSnapshot *s = new QcLiteLayerSnapshot;
+    s->entries = mEntries;
+    s->scales = mScaleCopies;
+    s->arcs = mArcs;
+    s->degrees = mDegrees;
+    s->values = mValues;
+    s->needles = mNeedles;
+    s->labels = mLabels;
+    return s;
 }
 
-void QcColorBand::draw(QPainter *painter)
+void QcLiteLayer::prepareEntries(const QRectF &tmpRect, qreal ratio, const QVector<Entry> &entries,
+                                 const QVector<QSharedPointer<QcScale> > &scales,
+                                 QVector<QcArcState> &arcs, QVector<QcDegreesState> &degrees,
+                                 QVector<QcValuesState> &values, QVector<QcNeedleState> &needles,
+                                 QVector<QcLabelState> &labels)
 {
-    resetRect();
-    float r = getRadius(rect());
-    QPen pen;
-    pen.setCapStyle(Qt::FlatCap);
-    pen.setWidthF(r/20.0);
-    painter->setBrush(Qt::NoBrush);
-    float offset = getDegFromValue();
-    for(int i = 0;i<mBandColors.size();i++){
-        QColor clr = mBandColors[i].first;
-        float sweep=0;
-        if(i==0)
-            sweep = getDegFromValue(mBandColors[i].second)-getDegFromValue(mMinValue);
-        else
-            sweep = getDegFromValue(mBandColors[i].second)-getDegFromValue(mBandColors[i-1].second);
-        QPainterPath path = createSubBand(-offset,sweep);
-        offset += sweep;
-        pen.setColor(clr);
-        painter->setPen(pen);
-        painter->drawPath(path);
+    for(int i = 0;i<entries.size();i++){
+        const Entry &e = entries.at(i);
+        switch (e.kind) {
+        case Arc:
+            arcs[e.index].prepare(tmpRect,*scales.at(e.scale),ratio);
+            break;
+        case Degrees:
+            degrees[e.index].prepare(tmpRect,*scales.at(e.scale),ratio);
+            break;
+        case Values:
+            values[e.index].prepare(tmpRect,*scales.at(e.scale),ratio);
+            break;
+        case Needle:
+            needles[e.index].prepare(tmpRect,*scales.at(e.scale),ratio);
+            break;
+        case Label:
+            labels[e.index].prepare(tmpRect,ratio);
+            break;
+        case Invalid:
+            break;
+        }
     }
 }
-void QcColorBand::setColors(const QList<QPair<QColor, float> > &colors)
-{
-    mBandColors = colors;
-    update();
-}
 
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-
-QcDegreesItem::QcDegreesItem(QObject *parent) :
-    QcScaleItem(parent)
+void QcLiteLayer::drawEntries(QPainter *painter, const QRectF &tmpRect, const QVector<Entry> &entries,
+                              const QVector<QSharedPointer<QcScale> > &scales,
+                              const QVector<QcArcState> &arcs, const QVector<QcDegreesState> &degrees,
+                              const QVector<QcValuesState> &values, const QVector<QcNeedleState> &needles,
+                              const QVector<QcLabelState> &labels)
 {
-    mStep = 10;
-    mColor = Qt::black;
-    mSubDegree = false;
-    setPosition(90);
+    for(int i = 0;i<entries.size();i++){
+        const Entry &e = entries.at(i);
+        switch (e.kind) {
+        case Arc:
+            arcs.at(e.index).paint(painter,tmpRect,*scales.at(e.scale));
+            break;
+        case Degrees:
+            degrees.at(e.index).paint(painter,tmpRect,*scales.at(e.scale));
+            break;
+        case Values:
+            values.at(e.index).paint(painter,tmpRect,*scales.at(e.scale));
+            break;
+        case Needle:
+            needles.at(e.index).paint(painter,tmpRect,*scales.at(e.scale));
+            break;
+        case Label:
+            labels.at(e.index).paint(painter,tmpRect);
+            break;
+        case Invalid:
+            break;
+        }
+    }
 }
 
-
-void QcDegreesItem::draw(QPainter *painter)
+int QcLiteLayer::addScale(const QSharedPointer<QcScale> &scale)
 {
-    resetRect();
-    QRectF tmpRect = adjustRect(position());
-
-    painter->setPen(mColor);
-    float r = getRadius(tmpRect);
-    for(float val = mMinValue;val<=mMaxValue;val+=mStep){
-        float deg = getDegFromValue(val);
-        QPointF pt = getPoint(deg,tmpRect);
-        QPainterPath path;
-        path.moveTo(pt);
-        path.lineTo(tmpRect.center());
-        pt = path.pointAtPercent(0.03);
-        QPointF newPt = path.pointAtPercent(0.13);
-
-        QPen pen;
-        pen.setColor(mColor);
-        if(!mSubDegree)
-            pen.setWidthF(r/25.0);
-
-        painter->setPen(pen);
-        painter->drawLine(pt,newPt);
-
-    }
+    int index = mScales.indexOf(scale);
+    if(index>=0)
+        return index;
+    mScales.append(scale);
+    connect(scale.data(),&QcScale::changed,this,&QcLiteLayer::scaleChanged);
+    return mScales.size()-1;
 }
 
-void QcDegreesItem::setStep(float step)
+int QcLiteLayer::addEntry(Kind kind, int index, int scale)
 {
-    mStep = step;
+    Entry e;
+    e.kind = kind;
+    e.index = index;
+    e.scale = scale;
+    e.label = -1;
+    mEntries.append(e);
     update();
+    return mEntries.size()-1;
 }
 
-void QcDegreesItem::setColor(const QColor& color)
+bool QcLiteLayer::isEntry(int handle, Kind kind)
 {
-    mColor = color;
-    update();
+    // Invalid matches any kind
+    return handle>=0 && handle<mEntries.size() && (kind==Invalid || mEntries[handle].kind==kind);
 }
 
-void QcDegreesItem::setSubDegree(bool b)
+// what the state accessors hand out for a bad handle, reset on every use
+template<typename T>
+static T &qcScratchState()
 {
-    mSubDegree = b;
-    update();
+    static T state;
+    state = T();
+    return state;
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-
-QcNeedleItem::QcNeedleItem(QObject *parent) :
-    QcScaleItem(parent)
+int QcLiteLayer::addArc(float position, int scale)
 {
-    mCurrentValue = 0;
-    mColor = Qt::black;
-    mLabel = NULL;
-    mNeedleType = FeatherNeedle;
+    if(scale<0 || scale>=mScales.size())
+        return -1;
+    QcArcState state;
+    state.position = position;
+    mArcs.append(state);
+    return addEntry(Arc,mArcs.size()-1,scale);
 }
 
-void QcNeedleItem::draw(QPainter *painter)
+int QcLiteLayer::addDegrees(float position, int scale, float step)
 {
-    resetRect();
-    QRectF tmpRect = adjustRect(position());
-    painter->save();
-    painter->translate(tmpRect.center());
-    float deg = getDegFromValue( mCurrentValue);
-    painter->rotate(deg+90.0);
-    painter->setBrush(QBrush(mColor));
-    painter->setPen(Qt::NoPen);
-
-    QLinearGradient grad;
-
-    switch (mNeedleType) {
-    case QcNeedleItem::FeatherNeedle:
-        createFeatherNeedle(getRadius(tmpRect));
-        break;
-    case QcNeedleItem::DiamonNeedle:
-        createDiamonNeedle(getRadius(tmpRect));
-        break;
-    case QcNeedleItem::TriangleNeedle:
-        createTriangleNeedle(getRadius(tmpRect));
-        break;
-    case QcNeedleItem::AttitudeMeterNeedle:
-        createAttitudeNeedle(getRadius(tmpRect));
-        break;
-    case QcNeedleItem::CompassNeedle:
-        createCompassNeedle(getRadius(tmpRect));
-        grad.setStart(mNeedlePoly[0]);
-        grad.setFinalStop(mNeedlePoly[1]);
-        grad.setColorAt(0.9,Qt::red);
-        grad.setColorAt(1,Qt::blue);
-        painter->setBrush(grad);
-
-        break;
-
-    default:
-        break;
-    }
-    painter->drawConvexPolygon(mNeedlePoly);
-    painter->restore();
+    if(scale<0 || scale>=mScales.size())
+        return -1;
+    QcDegreesState state;
+    state.quality = quality();
+    state.position = position;
+    state.ticks.setStep(step);
+    mDegrees.append(state);
+    return addEntry(Degrees,mDegrees.size()-1,scale);
 }
 
-void QcNeedleItem::setCurrentValue(float value)
+int QcLiteLayer::addValues(float position, int scale, float step)
 {
-       if(value<mMinValue)
-        mCurrentValue = mMinValue;
-    else if(value>mMaxValue)
-        mCurrentValue = mMaxValue;
-    else
-        mCurrentValue = value;
-
-    if(mLabel!=0)
-        mLabel->setText(QString::number(mCurrentValue),false);
+    if(scale<0 || scale>=mScales.size())
+        return -1;
+    QcValuesState state;
+    state.position = position;
+    state.ticks.setStep(step);
+    mValues.append(state);
+    return addEntry(Values,mValues.size()-1,scale);
+}
 
-/// This pull request is not working properly
-//    if(mLabel!=0){
-//        QString currentValue;
-//        mLabel->setText( currentValue ,false);
-//        mLabel->setText(currentValue.sprintf(mFormat.toStdString().c_str(), mCurrentValue),false);
-//        Q_UNUSED(currentValue);
-//    }
-    update();
+int QcLiteLayer::addNeedle(float position, int scale)
+{
+    if(scale<0 || scale>=mScales.size())
+        return -1;
+    QcNeedleState state;
+    state.quality = quality();
+    state.position = position;
+    state.currentValue = mScales[scale]->minValue();
+    mNeedles.append(state);
+    return addEntry(Needle,mNeedles.size()-1,scale);
 }
 
-float QcNeedleItem::currentValue()
+int QcLiteLayer::addLabel(float position, const QString &text)
 {
-    return mCurrentValue;
+    QcLabelState state;
+    state.position = position;
+    state.text = text;
+    mLabels.append(state);
+    return addEntry(Label,mLabels.size()-1,-1);
 }
 
-void QcNeedleItem::setValueFormat(QString format){
-    mFormat = format;
+void QcLiteLayer::clear()
+{
+    qDeleteAll(mFacades);
+    mFacades.clear();
+    for(int i = 0;i<mScales.size();i++)
+        disconnect(mScales[i].data(),&QcScale::changed,this,&QcLiteLayer::scaleChanged);
+    mEntries.clear();
+    mScales.clear();
+    mScaleCopies.clear();
+    mArcs.clear();
+    mDegrees.clear();
+    mValues.clear();
+    mNeedles.clear();
+    mLabels.clear();
     update();
 }
 
-QString QcNeedleItem::currentValueFormat(){
-    return mFormat;
+int QcLiteLayer::count()
+{
+    return mEntries.size();
 }
 
-void QcNeedleItem::setColor(const QColor &color)
+QcLiteLayer::Kind QcLiteLayer::kind(int handle)
 {
-    mColor = color;
-    update();
+    if(!isEntry(handle,Invalid))
+        return Invalid;
+    return mEntries[handle].kind;
 }
 
-QColor QcNeedleItem::color()
+QSharedPointer<QcScale> QcLiteLayer::scale(int handle)
 {
-    return mColor;
+    if(!isEntry(handle,Invalid))
+        return QSharedPointer<QcScale>();
+    int index = mEntries[handle].scale;
+    if(index<0)
+        return QSharedPointer<QcScale>();
+    return mScales[index];
 }
 
-void QcNeedleItem::setLabel(QcLabelItem *label)
+QcArcState &QcLiteLayer::arc(int handle)
 {
-    mLabel = label;
-    update();
+    if(!isEntry(handle,Arc))
+        return qcScratchState<QcArcState>();
+    return mArcs[mEntries[handle].index];
 }
 
-QcLabelItem *QcNeedleItem::label()
+QcDegreesState &QcLiteLayer::degrees(int handle)
 {
-    return mLabel;
+    if(!isEntry(handle,Degrees))
+        return qcScratchState<QcDegreesState>();
+    return mDegrees[mEntries[handle].index];
 }
 
-
-void QcNeedleItem::setNeedle(QcNeedleItem::NeedleType needleType)
+QcValuesState &QcLiteLayer::values(int handle)
 {
-    mNeedleType = needleType;
-    update();
+    if(!isEntry(handle,Values))
+        return qcScratchState<QcValuesState>();
+    return mValues[mEntries[handle].index];
 }
 
-
-void QcNeedleItem::createDiamonNeedle(float r)
+QcNeedleState &QcLiteLayer::needle(int handle)
 {
-    QVector<QPointF> tmpPoints;
-    tmpPoints.append(QPointF(0.0, 0.0));
-    tmpPoints.append(QPointF(-r/20.0,r/20.0));
-    tmpPoints.append(QPointF(0.0, r));
-    tmpPoints.append(QPointF(r/20.0,r/20.0));
-    mNeedlePoly = tmpPoints;
+    if(!isEntry(handle,Needle))
+        return qcScratchState<QcNeedleState>();
+    return mNeedles[mEntries[handle].index];
 }
 
-void QcNeedleItem::createTriangleNeedle(float r)
+QcLabelState &QcLiteLayer::label(int handle)
 {
-    QVector<QPointF> tmpPoints;
-    tmpPoints.append(QPointF(0.0, r));
-    tmpPoints.append(QPointF(-r/40.0, 0.0));
-    tmpPoints.append(QPointF(r/40.0,0.0));
-    mNeedlePoly = tmpPoints;
+    if(!isEntry(handle,Label))
+        return qcScratchState<QcLabelState>();
+    return mLabels[mEntries[handle].index];
 }
 
-void QcNeedleItem::createFeatherNeedle(float r)
+void QcLiteLayer::setCurrentValue(int needle, float value)
 {
-    QVector<QPointF> tmpPoints;
-    tmpPoints.append(QPointF(0.0, r));
-    tmpPoints.append(QPointF(-r/40.0, 0.0));
-    tmpPoints.append(QPointF(-r/15.0, -r/5.0));
-    tmpPoints.append(QPointF(r/15.0,-r/5));
-    tmpPoints.append(QPointF(r/40.0,0.0));
-    mNeedlePoly = tmpPoints;
+    if(!isEntry(needle,Needle) || !qIsFinite(value))
+        return;
+    const Entry &e = mEntries[needle];
+    const QcScale &s = *mScales[e.scale];
+    QcNeedleState &state = mNeedles[e.index];
+    if(value<s.minValue())
+        value = s.minValue();
+    else if(value>s.maxValue())
+        value = s.maxValue();
+    if(value==state.currentValue){
+        dropValue();
+        return;
+    }
+    state.currentValue = value;
+
+    if(e.label>=0){
+        if(!deferChanges())
+            setLabelValue(e,state.currentValue);
+        else if(!mLabelsDeferred){
+            mLabelsDeferred = true;
+            defer();
+        }
+    }
+    if(!mFacades.isEmpty()){
+        QcLiteItemFacade *f = mFacades.value(needle);
+        if(f)
+            emit f->currentValueChanged(state.currentValue);
+    }
+    update();
 }
 
-void QcNeedleItem::createAttitudeNeedle(float r)
+float QcLiteLayer::currentValue(int needle)
 {
-    QVector<QPointF> tmpPoints;
-    tmpPoints.append(QPointF(0.0, r));
-    tmpPoints.append(QPointF(-r/20.0, 0.85*r));
-    tmpPoints.append(QPointF(r/20.0,0.85*r));
-    mNeedlePoly = tmpPoints;
+    if(!isEntry(needle,Needle))
+        return 0;
+    return mNeedles[mEntries[needle].index].currentValue;
 }
 
-void QcNeedleItem::createCompassNeedle(float r)
+void QcLiteLayer::setText(int label, const QString &text)
 {
-    QVector<QPointF> tmpPoints;
-    tmpPoints.append(QPointF(0.0, r));
-    tmpPoints.append(QPointF(-r/15.0, 0.0));
-    tmpPoints.append(QPointF(0.0, -r));
-    tmpPoints.append(QPointF(r/15.0,0.0));
-    mNeedlePoly = tmpPoints;
+    if(!isEntry(label,Label))
+        return;
+    const Entry &e = mEntries[label];
+    mLabels[e.index].text = text;
+    mLabels[e.index].digitsLength = -1;
+    if(!mFacades.isEmpty()){
+        QcLiteItemFacade *f = mFacades.value(label);
+        if(f)
+            emit f->textChanged(text);
+    }
+    update();
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////
-
-QcValuesItem::QcValuesItem(QObject *parent) :
-    QcScaleItem(parent)
+void QcLiteLayer::setColor(int handle, const QColor &color)
 {
-    setPosition(70);
-    mColor = Qt::black;
-    mStep = 10;
-    mFont = "Arial";
+    if(!isEntry(handle,Invalid))
+        return;
+    const Entry &e = mEntries[handle];
+    switch (e.kind) {
+    case Arc:
+        mArcs[e.index].color = color;
+        break;
+    case Degrees:
+        mDegrees[e.index].color = color;
+        break;
+    case Values:
+        mValues[e.index].color = color;
+        break;
+    case Needle:
+        mNeedles[e.index].color = color;
+        break;
+    case Label:
+        mLabels[e.index].color = color;
+        break;
+    case Invalid:
+        break;
+    }
+    update();
 }
 
-
-void QcValuesItem::draw(QPainter*painter)
+QColor QcLiteLayer::color(int handle)
 {
-    QRectF  tmpRect = resetRect();
-    float r = getRadius(adjustRect(99));
-    QFont font(mFont,0, QFont::Bold);
-    font.setPointSizeF(0.08*r);
-
-    painter->setFont(font);
-    painter->setPen(mColor);
-    for(float val = mMinValue;val<=mMaxValue;val+=mStep){
-        float deg = getDegFromValue(val);
-        QPointF pt = getPoint(deg,tmpRect);
-        QPainterPath path;
-        path.moveTo(pt);
-        path.lineTo(    tmpRect.center());
-        QString strVal = QString::number(val);
-        QFontMetrics fMetrics = painter->fontMetrics();
-        QSize sz = fMetrics.size( Qt::TextSingleLine, strVal );
-        QRectF txtRect(QPointF(0,0), sz );
-        QPointF textCenter = path.pointAtPercent(1.0-position()/100.0);
-        txtRect.moveCenter(textCenter);
-
-        painter->drawText( txtRect, Qt::TextSingleLine, strVal );
+    if(!isEntry(handle,Invalid))
+        return QColor();
+    const Entry &e = mEntries[handle];
+    switch (e.kind) {
+    case Arc:
+        return mArcs[e.index].color;
+    case Degrees:
+        return mDegrees[e.index].color;
+    case Values:
+        return mValues[e.index].color;
+    case Needle:
+        return mNeedles[e.index].color;
+    case Label:
+        return mLabels[e.index].color;
+    case Invalid:
+        break;
     }
+    return QColor();
 }
 
-void QcValuesItem::setStep(float step)
+void QcLiteLayer::setLabelValue(const Entry &needle, float value)
 {
-    mStep = step;
+    const Entry &l = mEntries[needle.label];
+    mLabels[l.index].setValue(value);
+    if(!mFacades.isEmpty()){
+        QcLiteItemFacade *f = mFacades.value(needle.label);
+        if(f)
+            emit f->textChanged(mLabels[l.index].displayText());
+    }
 }
 
-float QcValuesItem::step() {
-    return mStep;
+void QcLiteLayer::setChannelValue(int handle, float value)
+{
+    setCurrentValue(handle,value);
 }
 
-void QcValuesItem::setColor(const QColor& color)
+void QcLiteLayer::applyDeferred()
 {
-    mColor = color;
+    if(!mLabelsDeferred)
+        return;
+    mLabelsDeferred = false;
+    // which labels are stale isn't tracked, every linked one is refreshed
+    for(int i=0;i<mEntries.size();i++){
+        const Entry &e = mEntries[i];
+        if(e.kind==Needle && e.label>=0)
+            setLabelValue(e,mNeedles[e.index].currentValue);
+    }
 }
 
-QColor QcValuesItem::color() {
-    return mColor;
+qint64 QcLiteLayer::cacheBytes()
+{
+    qint64 bytes = 0;
+    for(int i=0;i<mNeedles.size();i++)
+        bytes += mNeedles[i].sprites.cacheBytes();
+    return bytes;
 }
 
-void QcValuesItem::setFont(const QString& font)
+void QcLiteLayer::setLabel(int needle, int label)
 {
-    mFont = font;
+    if(!isEntry(needle,Needle) || (label>=0 && !isEntry(label,Label)))
+        return;
+    mEntries[needle].label = label;
+    // repeated values are dropped, so the label can't wait for the next one
+    if(label>=0){
+        setLabelValue(mEntries[needle],mNeedles[mEntries[needle].index].currentValue);
+        update();
+    }
 }
 
-QString QcValuesItem::font() {
-    return mFont;
+QcLiteItemFacade *QcLiteLayer::facade(int handle)
+{
+    if(!isEntry(handle,Invalid))
+        return 0;
+    QcLiteItemFacade *f = mFacades.value(handle);
+    if(!f){
+        f = new QcLiteItemFacade(this,handle);
+        mFacades.insert(handle,f);
+    }
+    return f;
 }
 
-
+void QcLiteLayer::scaleChanged()
+{
+    mScaleCopies.clear();
+    update();
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-QcAttitudeMeter::QcAttitudeMeter(QObject *parent) : QcItem(parent)
+QcLiteItemFacade::QcLiteItemFacade(QcLiteLayer *layer, int handle) :
+    QObject(layer)
 {
-    mPitch = 0;
-    mRoll = 0;
+    mLayer = layer;
+    mHandle = handle;
 }
-void QcAttitudeMeter::setCurrentPitch(float pitch)
+
+int QcLiteItemFacade::handle()
 {
-    mPitch=-pitch;
-    update();
+    return mHandle;
 }
-void QcAttitudeMeter::setCurrentRoll(float roll)
+
+float QcLiteItemFacade::currentValue()
 {
-    mRoll = roll;
-    update();
+    return mLayer->currentValue(mHandle);
 }
-QPointF QcAttitudeMeter::getIntersection(float r, const QPointF &pitchPoint, const QPointF &pt)
-{
-    // refrence it to zero
 
-    Q_UNUSED(r)
-    float a = (pitchPoint.y()-pt.y())/(pitchPoint.x()-pt.x());
-    float b = pt.y()-a*pt.x();
-    return QPointF(0,a*0+b);
-}
-float QcAttitudeMeter::getStartAngle(const QRectF& tmpRect)
+QString QcLiteItemFacade::text()
 {
-    float r = getRadius(tmpRect);
-    QPointF pt1 = getPoint(mRoll,tmpRect);
-    pt1.setY(pt1.y()-mPitchOffset);
-    QPointF pitchPoint = QPointF(tmpRect.center().x(),tmpRect.center().y()-mPitchOffset);
-
-
-    ///////////////////////////////////////
-    QPainterPath path1;
-    path1.moveTo(pitchPoint);
-    path1.lineTo(getIntersection(r,pitchPoint,pt1)+QPointF(0,5));
-    path1.lineTo(getIntersection(r,pitchPoint,pt1)+QPointF(0,-5));
-
-    QPainterPath path2;
-    path2.addEllipse(tmpRect);
-
-    QPointF p = path1.intersected(path2).pointAtPercent(.5);
-    return getAngle(p,tmpRect);
+    if(mLayer->kind(mHandle)!=QcLiteLayer::Label)
+        return QString();
+    return mLayer->label(mHandle).displayText();
 }
-void QcAttitudeMeter::draw(QPainter *painter)
-{
-    resetRect();
-    QRectF tmpRect = adjustRect(position());
-    float r = getRadius(tmpRect);
-    if(mPitch<0)
-        mPitchOffset = 0.0135*r*mPitch;
-    else
-        mPitchOffset = 0.015*r*mPitch;
-
-    painter->setPen(Qt::NoPen);
-    drawUpperEllipse(painter,tmpRect);
-    drawLowerEllipse(painter,tmpRect);
-
-    // Steps
-
-    drawPitchSteps(painter,tmpRect);
-    drawHandle(painter);
 
-    drawDegrees(painter);
-
-}
-void QcAttitudeMeter::drawDegrees(QPainter *painter)
+QColor QcLiteItemFacade::color()
 {
-    resetRect();
-    QRectF tmpRect = adjustRect(position());
-    float r = getRadius(tmpRect);
-    QPen pen;
-
-    pen.setColor(Qt::white);
-    painter->setPen(pen);
-    for(int deg = 60;deg<=120;deg+=10){
-        if(deg == 90)
-            continue;
-        drawDegree(painter,tmpRect,deg);
-    }
-
-    pen.setWidthF(r/30.0);
-    painter->setPen(pen);
-    drawDegree(painter,tmpRect,0);
-    drawDegree(painter,tmpRect,90);
-    drawDegree(painter,tmpRect,180);
-    drawDegree(painter,tmpRect,30);
-    drawDegree(painter,tmpRect,150);
+    return mLayer->color(mHandle);
 }
-void QcAttitudeMeter::drawDegree(QPainter * painter, const QRectF& tmpRect,float deg)
+
+void QcLiteItemFacade::setCurrentValue(float value)
 {
-    QPointF pt1 = getPoint(deg,tmpRect);
-    QPointF pt2 = tmpRect.center();
-    QPainterPath path;
-    path.moveTo(pt1);
-    path.lineTo(pt2);
-    QPointF pt = path.pointAtPercent(0.1);
-    painter->drawLine(pt1,pt);
+    mLayer->setCurrentValue(mHandle,value);
 }
-void QcAttitudeMeter::drawUpperEllipse(QPainter *painter, const QRectF &tmpRect)
-{
-
-    QLinearGradient radialGrad1(tmpRect.topLeft(),tmpRect.bottomRight());
-    QColor clr1 = Qt::blue;
-    clr1.setAlphaF(0.5);
-    QColor clr2 = Qt::darkBlue;
-    clr2.setAlphaF(0.5);
-    radialGrad1.setColorAt(0, clr1);
-    radialGrad1.setColorAt(.8, clr2);
-
-
-    float offset = getStartAngle(tmpRect);
-    float startAngle = 180-offset;
-    float endAngle = offset-2*mRoll;
-    float span =endAngle-startAngle;
-
-    painter->setBrush(radialGrad1);
-    painter->drawChord(tmpRect,16*startAngle,16*span);
 
-}
-void QcAttitudeMeter::drawLowerEllipse(QPainter *painter, const QRectF &tmpRect)
+void QcLiteItemFacade::setText(const QString &text)
 {
-    QLinearGradient radialGrad2(tmpRect.topLeft(),tmpRect.bottomRight());
-    QColor clr1 = QColor(139,119,118);
-    QColor clr2 = QColor(139,119,101);
-    radialGrad2.setColorAt(0, clr1);
-    radialGrad2.setColorAt(.8, clr2);
-
-    float offset = getStartAngle(tmpRect);
-    float startAngle = 180+offset;
-    float endAngle = offset-2*mRoll;
-    float span =endAngle+startAngle;
-
-    painter->setPen(Qt::NoPen);
-    painter->setBrush(radialGrad2);
-    painter->drawChord(tmpRect,-16*startAngle,16*span);
-
+    mLayer->setText(mHandle,text);
 }
-void QcAttitudeMeter::drawPitchSteps(QPainter *painter, const QRectF &tmpRect)
-{
-    float r = getRadius(tmpRect);
-    QPointF center = tmpRect.center();
-    painter->save();
-    painter->translate(center.x(),center.y()-mPitchOffset);
-    painter->rotate(mRoll);
-    QPen pen;
-    pen.setColor(Qt::white);
-    pen.setWidthF(r/40.0);
-
-    painter->setPen(pen);
-    for (int i = -30;i<=30;i+=10){
-        QPointF pt1;
-        pt1.setX(-0.01*r*abs(i));
-        pt1.setY(r/70.0*i);
-        QPointF pt2;
-        pt2.setX(0.01*r*abs(i));
-        pt2.setY(r/70.0*i);
-        painter->drawLine(pt1,pt2);
-
-        if(i==0)
-            continue;
 
-        // draw value
-        QFont font("Meiryo UI",0, QFont::Bold);
-        font.setPointSizeF(0.08*r);
-        painter->setFont(font);
-        QString strVal = QString::number(abs(i));
-        QFontMetrics fMetrics = painter->fontMetrics();
-        QSize sz = fMetrics.size( Qt::TextSingleLine, strVal );
-        QRectF leftTxtRect(QPointF(0,0), sz );
-        QRectF rightTxtRect(QPointF(0,0), sz );
-        leftTxtRect.moveCenter(pt1-QPointF(0.1*r,0));
-        rightTxtRect.moveCenter(pt2+QPointF(0.1*r,0));
-        painter->drawText( leftTxtRect, Qt::TextSingleLine, strVal );
-        painter->drawText( rightTxtRect, Qt::TextSingleLine, strVal );
-    }
-    painter->restore();
-}
-void QcAttitudeMeter::drawHandle(QPainter *painter)
+void QcLiteItemFacade::setColor(const QColor &color)
 {
-    QRectF tmpRct = adjustRect(15);
-    float r = getRadius(tmpRct);
-    QPen pen;
-    pen.setColor(Qt::gray);
-    pen.setWidthF(0.25*r);
-    painter->setPen(pen);
-    painter->drawArc(tmpRct,0,-16*180);
-
-    QPointF center = tmpRct.center();
-    QPointF leftPt1 = center;
-    QPointF leftPt2 = center;
-    QPointF rightPt1 = center;
-    QPointF rightPt2 = center;
-    leftPt1.setX(center.x()-2*r);
-    leftPt2.setX(center.x()-r);
-    rightPt1.setX(center.x()+2*r);
-    rightPt2.setX(center.x()+r);
-    painter->drawLine(leftPt1,leftPt2);
-    painter->drawLine(rightPt1,rightPt2);
-    painter->drawEllipse(adjustRect(2));
-
-    //
-    QPointF pt1 = center;
-    QPointF pt2 = center;
-    // to get the real 100 % radius, without recomputing
-    pt1.setY(center.y()+r);
-    pt2.setY(center.y()+4*r);
-    pen.setColor(Qt::gray);
-    painter->setPen(pen);
-    painter->drawLine(pt1,pt2);
-
-    // trapezium
-    painter->setPen(Qt::gray);
-    painter->setBrush(Qt::gray);
-    QPolygonF trapPoly;
-    QPointF tmpPt = center;
-    tmpPt.setX(center.x()-r);
-    tmpPt.setY(center.y()+4*r);
-    trapPoly.append(tmpPt);
-    tmpRct = adjustRect(position());
-    trapPoly.append(getPoint(290,tmpRct));
-    trapPoly.append(getPoint(250,tmpRct));
-    tmpPt = center;
-    tmpPt.setX(center.x()+r);
-    tmpPt.setY(center.y()+4*r);
-    trapPoly.append(tmpPt);
-    painter->drawPolygon(trapPoly);
-    painter->drawChord(tmpRct,-16*70,-16*40);
+    mLayer->setColor(mHandle,color);
 }
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 QcBar::QcBar(QWidget *parent): QWidget(parent) {}
@@ -1161,6 +6247,13 @@ void QcBar::drawProgress(QPainter *painter)
     }
     painter->restore();
 }
+// whether value is on a multiple of step, within float noise
+static bool qcOnStep(float value, double step)
+{
+    double n = value / step;
+    return qAbs(n - qRound64(n)) < 1e-3;
+}
+
 void QcBar::drawRulerTop(QPainter *painter)
 {
     painter->save();
@@ -1183,17 +6276,20 @@ void QcBar::drawRulerTop(QPainter *painter)
     int shortLineLen = 10;
 
     //Draw scale value and scale value according to range value. Long line needs to move 10 pixels. Short line needs to move 5 pixels.
-    for (int i = minValue; i <= maxValue; i = i + shortStep) {
-        if (i % longStep == 0) {
+    const QVector<float> &values = rulerTicks(length);
+    double longValue, halfValue;
+    rulerSteps(&longValue, &halfValue);
+    for (int t = 0; t < values.size(); t++) {
+        int i = qRound(values[t]);
+        initX = (values[t] - minValue) * increment;
+        if (longValue > 0 && qcOnStep(values[t], longValue)) {
             QPointF topPot = QPointF(initX, initTopY);
             QPointF bottomPot = QPointF(initX, initTopY + longLineLen);
             painter->drawLine(topPot, bottomPot);
 
             // The first value and the last value do not draw
-            if (i == minValue || i == maxValue) {
-                initX += increment * shortStep;
+            if (i == minValue || i == maxValue)
                 continue;
-            }
 
             QString strValue = QString("%1").arg((double)i, 0, 'f', precision);
             double textWidth = fontMetrics().width(strValue);
@@ -1202,7 +6298,7 @@ void QcBar::drawRulerTop(QPainter *painter)
             QPointF textPot = QPointF(initX - textWidth / 2, initTopY + textHeight + longLineLen);
             painter->drawText(textPot, strValue);
         } else {
-            if (i % (longStep / 2) == 0) {
+            if (halfValue > 0 && qcOnStep(values[t], halfValue)) {
                 shortLineLen = 10;
             } else {
                 shortLineLen = 6;
@@ -1212,8 +6308,6 @@ void QcBar::drawRulerTop(QPainter *painter)
             QPointF bottomPot = QPointF(initX, initTopY + shortLineLen);
             painter->drawLine(topPot, bottomPot);
         }
-
-        initX += increment * shortStep;
     }
 
     painter->restore();
@@ -1240,17 +6334,20 @@ void QcBar::drawRulerBottom(QPainter *painter)
     int shortLineLen = 10;
 
     //Draw scale value and scale value according to range value. Long line needs to move 10 pixels. Short line needs to move 5 pixels.
-    for (int i = minValue; i <= maxValue; i = i + shortStep) {
-        if (i % longStep == 0) {
+    const QVector<float> &values = rulerTicks(length);
+    double longValue, halfValue;
+    rulerSteps(&longValue, &halfValue);
+    for (int t = 0; t < values.size(); t++) {
+        int i = qRound(values[t]);
+        initX = (values[t] - minValue) * increment;
+        if (longValue > 0 && qcOnStep(values[t], longValue)) {
             QPointF topPot = QPointF(initX, initBottomY);
             QPointF bottomPot = QPointF(initX, initBottomY - longLineLen);
             painter->drawLine(topPot, bottomPot);
 
             // The first value and the last value do not draw
-            if (i == minValue || i == maxValue) {
-                initX += increment * shortStep;
+            if (i == minValue || i == maxValue)
                 continue;
-            }
 
             QString strValue = QString("%1").arg((double)i, 0, 'f', precision);
             double textWidth = fontMetrics().width(strValue);
@@ -1259,7 +6356,7 @@ void QcBar::drawRulerBottom(QPainter *painter)
             QPointF textPot = QPointF(initX - textWidth / 2, initBottomY - textHeight / 2 - longLineLen);
             painter->drawText(textPot, strValue);
         } else {
-            if (i % (longStep / 2) == 0) {
+            if (halfValue > 0 && qcOnStep(values[t], halfValue)) {
                 shortLineLen = 10;
             } else {
                 shortLineLen = 6;
@@ -1269,8 +6366,6 @@ void QcBar::drawRulerBottom(QPainter *painter)
             QPointF bottomPot = QPointF(initX, initBottomY - shortLineLen);
             painter->drawLine(topPot, bottomPot);
         }
-
-        initX += increment * shortStep;
     }
 
     painter->restore();
@@ -1295,17 +6390,20 @@ void QcBar::drawRulerLeft(QPainter *painter)
     int shortLineLen = 10;
 
     //Draw scale value according to range value. Long line needs to move 10 pixels and short line needs to move 5 pixels.
-    for (int i = minValue; i <= maxValue; i = i + shortStep) {
-        if (i % longStep == 0) {
+    const QVector<float> &values = rulerTicks(length);
+    double longValue, halfValue;
+    rulerSteps(&longValue, &halfValue);
+    for (int t = 0; t < values.size(); t++) {
+        int i = qRound(values[t]);
+        y = height() - (values[t] - minValue) * increment;
+        if (longValue > 0 && qcOnStep(values[t], longValue)) {
             QPointF leftPoint = QPointF(x, y);
             QPointF rightPoint = QPointF(x + longLineLen, y);
             painter->drawLine(leftPoint, rightPoint);
 
             // The first value and the last value do not draw
-            if (i == minValue || i == maxValue) {
-                y -= increment * shortStep;
+            if (i == minValue || i == maxValue)
                 continue;
-            }
 
             QString strValue = QString("%1").arg((double)i, 0, 'f', precision);
             double textWidth = fontMetrics().width(strValue);
@@ -1316,7 +6414,7 @@ void QcBar::drawRulerLeft(QPainter *painter)
 
             painter->drawText(textPot, strValue);
         } else {
-            if (i % (longStep / 2) == 0) {
+            if (halfValue > 0 && qcOnStep(values[t], halfValue)) {
                 shortLineLen = 10;
             } else {
                 shortLineLen = 6;
@@ -1326,8 +6424,6 @@ void QcBar::drawRulerLeft(QPainter *painter)
             QPointF rightP = QPointF(x+ shortLineLen, y );
             painter->drawLine(leftP, rightP);
         }
-
-        y -= increment * shortStep;
     }
 
     painter->restore();
@@ -1348,18 +6444,21 @@ void QcBar::drawRulerRight(QPainter *painter)
     int shortLineLen = 10;
 
     //Draw scale value according to range value. Long line needs to move 10 pixels. Short line needs to move 5 pixels.
-    for (int i = minValue; i <= maxValue; i = i + shortStep) {
-        if (i % longStep == 0) {
+    const QVector<float> &values = rulerTicks(length);
+    double longValue, halfValue;
+    rulerSteps(&longValue, &halfValue);
+    for (int t = 0; t < values.size(); t++) {
+        int i = qRound(values[t]);
+        y = height() - (values[t] - minValue) * increment;
+        if (longValue > 0 && qcOnStep(values[t], longValue)) {
 
             QPointF leftPoint = QPointF(x - longLineLen, y);
             QPointF rightPoint = QPointF(x, y);
             painter->drawLine(rightPoint, leftPoint);
 
             // The first value and the last value do not draw
-            if (i == minValue || i == maxValue) {
-                y -= increment * shortStep;
+            if (i == minValue || i == maxValue)
                 continue;
-            }
 
             QString strValue = QString("%1").arg((double)i, 0, 'f', precision);
             double textWidth = fontMetrics().width(strValue);
@@ -1369,7 +6468,7 @@ void QcBar::drawRulerRight(QPainter *painter)
 
             painter->drawText(textPot, strValue);
         } else {
-            if (i % (longStep / 2) == 0) {
+            if (halfValue > 0 && qcOnStep(values[t], halfValue)) {
                 shortLineLen = 10;
             } else {
                 shortLineLen = 6;
@@ -1379,13 +6478,37 @@ void QcBar::drawRulerRight(QPainter *painter)
             QPointF rightP = QPointF(x, y);
             painter->drawLine(rightP,leftP);
         }
-
-        y -= increment * shortStep;
     }
 
     painter->restore();
 }
 
+const QVector<float> &QcBar::rulerTicks(double length)
+{
+    ticks.setRange(minValue, maxValue);
+    ticks.setStep(shortStep);
+    ticks.setLength(length);
+    ticks.setAutoSpacing(RulerTickSpacing);
+    return ticks.ticks();
+}
+
+void QcBar::rulerSteps(double *longValue, double *halfValue)
+{
+    // a long tick every longStep/shortStep ticks, also when the ticks are
+    // coarsened to keep them RulerTickSpacing apart, so the labels on the
+    // long ticks thin out with them
+    double step = ticks.effectiveStep();
+    *longValue = 0;
+    *halfValue = 0;
+    if (!(step > 0) || longStep <= 0)
+        return;
+    int count = shortStep > 0 ? qMax(1, qRound(double(longStep) / shortStep))
+                              : qMax(1, qRound(longStep / step));
+    *longValue = step * count;
+    if (count > 1)
+        *halfValue = step * (count / 2);
+}
+
 QcBar::DirectionEnum QcBar::getDirection() const {return direction;}
 double QcBar::getMinValue() const{ return minValue;}
 double QcBar::getMaxValue() const{return maxValue;}